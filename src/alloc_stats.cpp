@@ -0,0 +1,34 @@
+#include <cstdlib>
+#include <new>
+#include "alloc_stats.h"
+
+// Replaces the global allocation functions to count every heap allocation of
+// the process. Only linked in allocation accounting builds.
+
+static thread_local alloc_counter counter = {0, 0};
+
+alloc_counter alloc_snapshot() {
+  return counter;
+}
+
+void *operator new(size_t size) {
+  counter.count++;
+  counter.bytes += size;
+  void *p = malloc(size ? size : 1);
+  if(!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
@@ -0,0 +1,23 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <cstdint>
+
+// Heap allocations made by the calling thread since it started. Counting is
+// only compiled in with PATH_PLANNING_ALLOC_STATS (cmake -DALLOC_STATS=ON),
+// which links alloc_stats.cpp and its global operator new/delete; otherwise
+// the snapshot is always zero and costs nothing.
+struct alloc_counter {
+  uint64_t count;
+  uint64_t bytes;
+};
+
+#ifdef PATH_PLANNING_ALLOC_STATS
+alloc_counter alloc_snapshot();
+inline bool alloc_stats_enabled() { return true; }
+#else
+inline alloc_counter alloc_snapshot() { return alloc_counter{0, 0}; }
+inline bool alloc_stats_enabled() { return false; }
+#endif
+
+#endif // ALLOC_STATS_H
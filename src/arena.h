@@ -0,0 +1,188 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Monotonic bump allocator for everything a planning cycle allocates. Memory is
+// only given back by reset(), which rewinds to the start. When a cycle does not
+// fit, extra blocks are chained and folded into one larger block on the next
+// reset, so after a few cycles a connection plans from a single block without
+// calling the global allocator at all.
+class monotonic_arena {
+public:
+  explicit monotonic_arena(size_t block_size = 256 * 1024)
+    : current(0), offset(0), peak(0), used_total(0) {
+    add_block(block_size);
+  }
+
+  ~monotonic_arena() {
+    for(size_t i = 0; i < blocks.size(); i++) {
+      ::operator delete(blocks[i].data);
+    }
+  }
+
+  void *allocate(size_t bytes, size_t align) {
+    for(;;) {
+      block &b = blocks[current];
+      size_t start = (offset + align - 1) & ~(align - 1);
+      if(start + bytes <= b.size) {
+        offset = start + bytes;
+        used_total += bytes;
+        if(used_total > peak) {
+          peak = used_total;
+        }
+        return b.data + start;
+      }
+      if(current + 1 == blocks.size()) {
+        add_block(bytes + align > b.size ? bytes + align : b.size);
+      }
+      current++;
+      offset = 0;
+    }
+  }
+
+  // Forgets everything allocated so far
+  void reset() {
+    if(blocks.size() > 1) {
+      size_t total = 0;
+      for(size_t i = 0; i < blocks.size(); i++) {
+        total += blocks[i].size;
+        ::operator delete(blocks[i].data);
+      }
+      blocks.clear();
+      add_block(total);
+    }
+    current = 0;
+    offset = 0;
+    used_total = 0;
+  }
+
+  bool owns(const void *p) const {
+    const char *c = (const char *)p;
+    for(size_t i = 0; i < blocks.size(); i++) {
+      if(c >= blocks[i].data && c < blocks[i].data + blocks[i].size) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  size_t capacity() const {
+    size_t total = 0;
+    for(size_t i = 0; i < blocks.size(); i++) {
+      total += blocks[i].size;
+    }
+    return total;
+  }
+
+  // Most bytes handed out in one cycle
+  size_t peak_used() const { return peak; }
+
+private:
+  struct block {
+    char *data;
+    size_t size;
+  };
+
+  void add_block(size_t size) {
+    block b;
+    b.data = (char *)::operator new(size);
+    b.size = size;
+    blocks.push_back(b);
+  }
+
+  std::vector<block> blocks;
+  size_t current;
+  size_t offset;
+  size_t peak;
+  size_t used_total;
+};
+
+// The arena arena_allocator draws from on this thread, if any
+inline monotonic_arena *&current_arena() {
+  static thread_local monotonic_arena *arena = nullptr;
+  return arena;
+}
+
+// Makes an arena current for one planning cycle and resets it first. Every
+// arena_allocator container filled inside the scope must be destroyed before
+// the scope ends.
+class arena_scope {
+public:
+  explicit arena_scope(monotonic_arena &arena) : previous(current_arena()) {
+    arena.reset();
+    current_arena() = &arena;
+  }
+
+  ~arena_scope() {
+    current_arena() = previous;
+  }
+
+private:
+  monotonic_arena *previous;
+};
+
+// Stateless allocator over the current arena. Without a current arena it falls
+// back to the global allocator, so the same containers work outside a cycle.
+// Stateless because nlohmann::basic_json default-constructs its AllocatorType.
+template <typename T>
+class arena_allocator {
+public:
+  typedef T value_type;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <typename U> struct rebind { typedef arena_allocator<U> other; };
+
+  arena_allocator() {}
+  template <typename U> arena_allocator(const arena_allocator<U> &) {}
+
+  T *allocate(size_t n) {
+    monotonic_arena *arena = current_arena();
+    if(arena) {
+      return (T *)arena->allocate(n * sizeof(T), alignof(T));
+    }
+    return (T *)::operator new(n * sizeof(T));
+  }
+
+  void deallocate(T *p, size_t) {
+    monotonic_arena *arena = current_arena();
+    if(arena && arena->owns(p)) {
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *p, Args&&... args) {
+    ::new((void *)p) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  void destroy(U *p) {
+    p->~U();
+  }
+
+  size_t max_size() const { return SIZE_MAX / sizeof(T); }
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T> &, const arena_allocator<U> &) { return true; }
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T> &, const arena_allocator<U> &) { return false; }
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+#endif // ARENA_H
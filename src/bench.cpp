@@ -0,0 +1,103 @@
+// Plans a recorded telemetry corpus in process, as fast as it goes, and
+// reports the throughput. Links the same path_planner_core as the server,
+// which makes it the training run of profile-guided builds (see README).
+//
+//   bench <corpus> [--map <file>] [--config <file>] [--iterations <n>]
+//
+// Every iteration drives a fresh session through the whole corpus.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "planner.h"
+#include "protocol.h"
+#include "arena.h"
+
+using namespace std;
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    cerr << "Usage: " << argv[0] << " <corpus> [--map <file>] [--config <file>] [--iterations <n>]"
+         << endl;
+    return 2;
+  }
+
+  string corpus_file = argv[1];
+  string map_file = "../data/highway_map.csv";
+  string config_file = "../data/planner_config.json";
+  int iterations = 20;
+  for(int i = 2; i + 1 < argc; i += 2) {
+    string option = argv[i];
+    string value = argv[i + 1];
+    if(option == "--map") map_file = value;
+    else if(option == "--config") config_file = value;
+    else if(option == "--iterations") iterations = atoi(value.c_str());
+    else {
+      cerr << "Unknown option " << option << endl;
+      return 2;
+    }
+  }
+
+  highway_map map;
+  if(!load_map(map_file, map)) {
+    cerr << "Cannot read map " << map_file << endl;
+    return 2;
+  }
+  planner_config config;
+  if(!load_config(config_file, config)) {
+    cerr << "Cannot read config " << config_file << endl;
+    return 2;
+  }
+  vector<string> frames;
+  ifstream in(corpus_file.c_str());
+  string line;
+  while(getline(in, line)) {
+    if(!line.empty()) {
+      frames.push_back(line);
+    }
+  }
+  if(frames.empty()) {
+    cerr << "Cannot read corpus " << corpus_file << endl;
+    return 2;
+  }
+  for(size_t i = 0; i < frames.size(); i++) {
+    const char *first, *last;
+    if(!hasData(frames[i].data(), frames[i].size(), first, last)) {
+      cerr << "Line " << i + 1 << " of " << corpus_file << " is not a telemetry message" << endl;
+      return 2;
+    }
+  }
+
+  // stage latencies of the last iteration, the steadiest
+  stage_stats stats;
+  monotonic_arena arena;
+  size_t bytes = 0; // of the replies, so the work cannot be optimized away
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  for(int iteration = 0; iteration < iterations; iteration++) {
+    planner_session session(map, config);
+    for(size_t i = 0; i < frames.size(); i++) {
+      arena_scope scope(arena);
+      const char *first = nullptr, *last = nullptr;
+      hasData(frames[i].data(), frames[i].size(), first, last);
+      telemetry_json j = telemetry_json::parse(first, last);
+      planned_path path;
+      plan(j[1], session, path);
+      arena_string msg;
+      write_control_message(msg, path.x, path.y);
+      bytes += msg.length();
+    }
+    stats = session.stats;
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  json report = stats.to_json();
+  report["frames"] = frames.size() * iterations;
+  report["seconds"] = seconds;
+  report["frames_per_second"] = frames.size() * iterations / seconds;
+  report["reply_bytes"] = bytes;
+  cout << report.dump(2) << endl;
+  return 0;
+}
@@ -0,0 +1,194 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include "planner.h"
+
+// Compact alternative to the JSON events for clients that ask for it when
+// they connect (see README). Every message is one binary websocket frame: a
+// header of
+//
+//   uint16 version, uint16 kind, uint32 length (bytes after the header)
+//
+// and a body of little-endian values. A telemetry body is
+//
+//   int32 previous_size (at most PATH_RING_CAPACITY), int32 vehicles,
+//   double x, y, s, d, yaw, speed, end_path_s, end_path_d,
+//   double previous_x[previous_size], previous_y[previous_size],
+//   double sensor_fusion[vehicles * 7] ([id, x, y, vx, vy, s, d] rows)
+//
+// with the units of the JSON event, and a control body is
+//
+//   int32 size, int32 reserved, double next_x[size], next_y[size]
+
+const uint16_t BINARY_PROTOCOL_VERSION = 1;
+const uint16_t BINARY_TELEMETRY = 1;
+const uint16_t BINARY_CONTROL = 2;
+const size_t BINARY_HEADER_SIZE = 8;
+const int BINARY_TELEMETRY_SCALARS = 8; // x ... end_path_d
+
+namespace binary_protocol {
+
+inline bool little_endian_host() {
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+  return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+  const uint16_t probe = 1;
+  return *reinterpret_cast<const unsigned char *>(&probe) == 1;
+#endif
+}
+
+// Copies n little-endian values of sizeof(T) bytes from in to out
+template <typename T>
+void read_values(const char *in, T *out, size_t n) {
+  memcpy(out, in, n * sizeof(T));
+  if(!little_endian_host()) {
+    for(size_t i = 0; i < n; i++) {
+      char *bytes = reinterpret_cast<char *>(out + i);
+      std::reverse(bytes, bytes + sizeof(T));
+    }
+  }
+}
+
+template <typename String, typename T>
+void write_values(String &out, const T *values, size_t n) {
+  if(little_endian_host()) {
+    out.append(reinterpret_cast<const char *>(values), n * sizeof(T));
+    return;
+  }
+  for(size_t i = 0; i < n; i++) {
+    char bytes[sizeof(T)];
+    memcpy(bytes, values + i, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    out.append(bytes, sizeof(T));
+  }
+}
+
+template <typename String>
+void write_header(String &out, uint16_t kind, uint32_t length) {
+  const uint16_t version = BINARY_PROTOCOL_VERSION;
+  write_values(out, &version, 1);
+  write_values(out, &kind, 1);
+  write_values(out, &length, 1);
+}
+
+// Body of a message of the given kind, or null if the frame is not one of
+// this version or its length does not match the header
+inline const char *read_header(const char *data, size_t length, uint16_t kind, uint32_t &body_length) {
+  if(length < BINARY_HEADER_SIZE) {
+    return nullptr;
+  }
+  uint16_t version, message_kind;
+  read_values(data, &version, 1);
+  read_values(data + 2, &message_kind, 1);
+  read_values(data + 4, &body_length, 1);
+  if(version != BINARY_PROTOCOL_VERSION || message_kind != kind ||
+     body_length != length - BINARY_HEADER_SIZE) {
+    return nullptr;
+  }
+  return data + BINARY_HEADER_SIZE;
+}
+
+}
+
+// Decodes a binary telemetry message into frame, whose arrays then point
+// into storage. Returns false, leaving frame unspecified, if the message is
+// malformed.
+inline bool read_telemetry_message(const char *data, size_t length, path_buffer &storage,
+                                   telemetry_frame &frame) {
+  uint32_t body_length;
+  const char *body = binary_protocol::read_header(data, length, BINARY_TELEMETRY, body_length);
+  if(!body || body_length < 8 + BINARY_TELEMETRY_SCALARS * sizeof(double)) {
+    return false;
+  }
+  int32_t counts[2];
+  binary_protocol::read_values(body, counts, 2);
+  int64_t prev_size = counts[0];
+  int64_t vehicles = counts[1];
+  // a longer previous path than the planner's copy of it cannot be one it sent
+  if(prev_size < 0 || prev_size > PATH_RING_CAPACITY || vehicles < 0) {
+    return false;
+  }
+  int64_t values = 2 * prev_size + vehicles * telemetry_frame::SENSOR_FUSION_FIELDS;
+  if(body_length != 8 + (BINARY_TELEMETRY_SCALARS + values) * sizeof(double)) {
+    return false;
+  }
+
+  double scalars[BINARY_TELEMETRY_SCALARS];
+  binary_protocol::read_values(body + 8, scalars, BINARY_TELEMETRY_SCALARS);
+  frame.x = scalars[0];
+  frame.y = scalars[1];
+  frame.s = scalars[2];
+  frame.d = scalars[3];
+  frame.yaw = scalars[4];
+  frame.speed = scalars[5];
+  frame.end_path_s = scalars[6];
+  frame.end_path_d = scalars[7];
+
+  // copied out, as the doubles of a websocket frame need not be aligned
+  storage.resize(values);
+  binary_protocol::read_values(body + 8 + BINARY_TELEMETRY_SCALARS * sizeof(double), storage.data(), values);
+  frame.previous_x = storage.data();
+  frame.previous_y = storage.data() + prev_size;
+  frame.previous_size = prev_size;
+  frame.sensor_fusion = storage.data() + 2 * prev_size;
+  frame.vehicles = vehicles;
+  return true;
+}
+
+// Writes frame as a binary telemetry message, the client's side
+template <typename String>
+void write_telemetry_message(String &out, const telemetry_frame &frame) {
+  int64_t values = 2 * frame.previous_size + frame.vehicles * telemetry_frame::SENSOR_FUSION_FIELDS;
+  uint32_t body_length = 8 + (BINARY_TELEMETRY_SCALARS + values) * sizeof(double);
+  out.clear();
+  out.reserve(BINARY_HEADER_SIZE + body_length);
+  binary_protocol::write_header(out, BINARY_TELEMETRY, body_length);
+  const int32_t counts[2] = {frame.previous_size, frame.vehicles};
+  binary_protocol::write_values(out, counts, 2);
+  const double scalars[BINARY_TELEMETRY_SCALARS] = {
+    frame.x, frame.y, frame.s, frame.d, frame.yaw, frame.speed, frame.end_path_s, frame.end_path_d
+  };
+  binary_protocol::write_values(out, scalars, BINARY_TELEMETRY_SCALARS);
+  binary_protocol::write_values(out, frame.previous_x, frame.previous_size);
+  binary_protocol::write_values(out, frame.previous_y, frame.previous_size);
+  binary_protocol::write_values(out, frame.sensor_fusion, frame.vehicles * telemetry_frame::SENSOR_FUSION_FIELDS);
+}
+
+// Binary counterpart of write_control_message
+template <typename String, typename Path>
+void write_control_binary(String &out, const Path &next_x_vals, const Path &next_y_vals) {
+  const int32_t header[2] = {(int32_t)next_x_vals.size(), 0};
+  uint32_t body_length = 8 + 2 * next_x_vals.size() * sizeof(double);
+  out.clear();
+  out.reserve(BINARY_HEADER_SIZE + body_length);
+  binary_protocol::write_header(out, BINARY_CONTROL, body_length);
+  binary_protocol::write_values(out, header, 2);
+  binary_protocol::write_values(out, next_x_vals.data(), next_x_vals.size());
+  binary_protocol::write_values(out, next_y_vals.data(), next_y_vals.size());
+}
+
+// Decodes a binary control message into the points of the path, the
+// client's side. Returns false if it is malformed.
+template <typename Path>
+bool read_control_message(const char *data, size_t length, Path &next_x_vals, Path &next_y_vals) {
+  uint32_t body_length;
+  const char *body = binary_protocol::read_header(data, length, BINARY_CONTROL, body_length);
+  if(!body || body_length < 8) {
+    return false;
+  }
+  int32_t size;
+  binary_protocol::read_values(body, &size, 1);
+  if(size < 0 || body_length != 8 + 2 * (uint64_t)size * sizeof(double)) {
+    return false;
+  }
+  next_x_vals.resize(size);
+  next_y_vals.resize(size);
+  binary_protocol::read_values(body + 8, next_x_vals.data(), size);
+  binary_protocol::read_values(body + 8 + size * sizeof(double), next_y_vals.data(), size);
+  return true;
+}
+
+#endif // BINARY_PROTOCOL_H
@@ -0,0 +1,196 @@
+#include <math.h>
+#include "collision_checker.h"
+
+namespace {
+
+const double NO_CONTACT = HUGE_VAL;
+
+// Centers of the circles along the length of a vehicle, and their radius,
+// which reaches the corners of the vehicle's share of its length
+const double OFFSETS[collision_checker::CIRCLES] = {
+  -collision_checker::VEHICLE_LENGTH / 3, 0, collision_checker::VEHICLE_LENGTH / 3
+};
+const double RADIUS = sqrt(pow(collision_checker::VEHICLE_LENGTH / (2 * collision_checker::CIRCLES), 2) +
+                           pow(collision_checker::VEHICLE_WIDTH / 2, 2));
+
+// Least squared distance between the ego circles (ego_s, ego_d) at time t and
+// the circles of every vehicle, interpolated by f between two predicted
+// steps, folded into the closest approach and first contact of each vehicle
+void narrow_kernel(int n, double t, double f, double contact_limit,
+                   const double *__restrict ego_s, const double *__restrict ego_d,
+                   const double *__restrict s0, const double *__restrict s1,
+                   const double *__restrict d0, const double *__restrict d1,
+                   double *__restrict clearance, double *__restrict closest,
+                   double *__restrict contact) {
+  for(int j = 0; j < n; j++) {
+    double s = s0[j] + f * (s1[j] - s0[j]);
+    double d = d0[j] + f * (d1[j] - d0[j]);
+    double best = NO_CONTACT;
+    for(int a = 0; a < collision_checker::CIRCLES; a++) {
+      double dd = d - ego_d[a];
+      for(int b = 0; b < collision_checker::CIRCLES; b++) {
+        double ds = s + OFFSETS[b] - ego_s[a];
+        double q = ds * ds + dd * dd;
+        best = q < best ? q : best;
+      }
+    }
+    // loaded first and two selects on differently written conditions, or
+    // GCC turns them into branches
+    double least = clearance[j];
+    double least_time = closest[j];
+    double first = contact[j];
+    double hit = best < contact_limit ? t : NO_CONTACT;
+    closest[j] = least - best > 0 ? t : least_time;
+    clearance[j] = best < least ? best : least;
+    contact[j] = hit < first ? hit : first;
+  }
+}
+
+}
+
+void collision_checker::reset(const prediction_tensor &prediction, const sensor_fusion_frame &vehicles,
+                              double ego_s, double max_s, const planner_config &config) {
+  step_count = prediction.steps();
+  start = prediction.step_time(0);
+  step_s = prediction.step_time(1) - prediction.step_time(0);
+  reference_s = ego_s;
+  track_length = max_s;
+
+  entry_count = 0;
+  for(int m = 0; m < MANOEUVRE_COUNT; m++) {
+    const double *probability = prediction.probability((manoeuvre)m);
+    for(int i = 0; i < prediction.vehicles(); i++) {
+      entry_count += probability[i] >= config.grid_min_probability;
+    }
+  }
+  entry_id.assign(entry_count, -1);
+  entry_s.assign(step_count * entry_count, 0.0);
+  entry_d.assign(step_count * entry_count, 0.0);
+  entry_s_min.assign(entry_count, 0.0);
+  entry_s_max.assign(entry_count, 0.0);
+  near.assign(entry_count, 0);
+  near_s.assign(step_count * entry_count, 0.0);
+  near_d.assign(step_count * entry_count, 0.0);
+  near_clearance.assign(entry_count, 0.0);
+  near_closest.assign(entry_count, 0.0);
+  near_contact.assign(entry_count, 0.0);
+
+  const double *id = vehicles[sensor_fusion_frame::ID];
+  int e = 0;
+  for(int m = 0; m < MANOEUVRE_COUNT; m++) {
+    const double *probability = prediction.probability((manoeuvre)m);
+    for(int i = 0; i < prediction.vehicles(); i++) {
+      if(probability[i] < config.grid_min_probability) {
+        continue;
+      }
+      // the lap nearest to the ego car, for the whole trajectory
+      double first_s = prediction.s(0, (manoeuvre)m)[i];
+      double shift = -max_s * floor((first_s - ego_s) / max_s + 0.5);
+      double s_min = first_s + shift;
+      double s_max = s_min;
+      for(int step = 0; step < step_count; step++) {
+        double s = prediction.s(step, (manoeuvre)m)[i] + shift;
+        entry_s[step * entry_count + e] = s;
+        entry_d[step * entry_count + e] = prediction.d(step, (manoeuvre)m)[i];
+        s_min = min(s_min, s);
+        s_max = max(s_max, s);
+      }
+      entry_id[e] = (int)id[i];
+      entry_s_min[e] = s_min;
+      entry_s_max[e] = s_max;
+      e++;
+    }
+  }
+}
+
+collision_result collision_checker::check(const double *s, const double *d, int count,
+                                          double start_time, double dt) {
+  collision_result result;
+  result.collides = false;
+  result.time = start_time;
+  result.id = -1;
+  result.clearance = NO_CONTACT;
+  if(count == 0 || entry_count == 0) {
+    return result;
+  }
+
+  // broad phase: entries whose s interval comes within reach of the ego car's
+  double ego_min = HUGE_VAL;
+  double ego_max = -HUGE_VAL;
+  for(int i = 0; i < count; i++) {
+    double ego = s[i] - track_length * floor((s[i] - reference_s) / track_length + 0.5);
+    ego_min = min(ego_min, ego);
+    ego_max = max(ego_max, ego);
+  }
+  double reach = VEHICLE_LENGTH + 2 * RADIUS;
+  int near_count = 0;
+  for(int e = 0; e < entry_count; e++) {
+    if(entry_s_max[e] >= ego_min - reach && entry_s_min[e] <= ego_max + reach) {
+      near[near_count++] = e;
+    }
+  }
+  if(near_count == 0) {
+    return result;
+  }
+  for(int step = 0; step < step_count; step++) {
+    const double *from_s = entry_s.data() + step * entry_count;
+    const double *from_d = entry_d.data() + step * entry_count;
+    for(int k = 0; k < near_count; k++) {
+      near_s[step * near_count + k] = from_s[near[k]];
+      near_d[step * near_count + k] = from_d[near[k]];
+    }
+  }
+  double *clearance = near_clearance.data();
+  double *closest = near_closest.data();
+  double *contact = near_contact.data();
+  for(int k = 0; k < near_count; k++) {
+    clearance[k] = NO_CONTACT;
+    closest[k] = start_time;
+    contact[k] = NO_CONTACT;
+  }
+
+  // narrow phase, one ego point against all near entries at a time
+  double contact_limit = 4 * RADIUS * RADIUS;
+  for(int i = 0; i < count; i++) {
+    double ego = s[i] - track_length * floor((s[i] - reference_s) / track_length + 0.5);
+    // direction of travel, from the neighbouring point
+    int next = i + 1 < count ? i + 1 : i;
+    int prev = i + 1 < count ? i : max(i - 1, 0);
+    double ds = s[next] - s[prev];
+    double dd = d[next] - d[prev];
+    double norm = sqrt(ds * ds + dd * dd);
+    double along_s = norm > 1e-6 ? ds / norm : 1;
+    double along_d = norm > 1e-6 ? dd / norm : 0;
+    double ego_s[CIRCLES], ego_d[CIRCLES];
+    for(int a = 0; a < CIRCLES; a++) {
+      ego_s[a] = ego + OFFSETS[a] * along_s;
+      ego_d[a] = d[i] + OFFSETS[a] * along_d;
+    }
+
+    double t = start_time + i * dt;
+    double u = max(0.0, min((t - start) / step_s, (double)(step_count - 1)));
+    int step = min((int)u, step_count - 1);
+    int next_step = min(step + 1, step_count - 1);
+    narrow_kernel(near_count, t, u - step, contact_limit, ego_s, ego_d,
+                  near_s.data() + step * near_count, near_s.data() + next_step * near_count,
+                  near_d.data() + step * near_count, near_d.data() + next_step * near_count,
+                  clearance, closest, contact);
+  }
+
+  int nearest = 0;
+  int first = -1;
+  for(int k = 0; k < near_count; k++) {
+    if(clearance[k] < clearance[nearest]) {
+      nearest = k;
+    }
+    if(contact[k] != NO_CONTACT && (first < 0 || contact[k] < contact[first])) {
+      first = k;
+    }
+  }
+  result.collides = first >= 0;
+  int k = result.collides ? first : nearest;
+  result.time = result.collides ? contact[k] : closest[k];
+  result.id = entry_id[near[k]];
+  result.clearance = sqrt(clearance[k]) - 2 * RADIUS;
+  return result;
+}
@@ -0,0 +1,66 @@
+#ifndef COLLISION_CHECKER_H
+#define COLLISION_CHECKER_H
+
+#include "arena.h"
+#include "planner.h"
+#include "prediction.h"
+#include "sensor_fusion.h"
+
+// Outcome of checking one ego trajectory
+struct collision_result {
+  bool collides;
+  double time; // s after the frame of the first contact, or of the closest approach
+  int id; // sensor fusion id of the vehicle hit or passed closest, -1 if none was near
+  double clearance; // least distance between two circles of the covers, negative on contact, m
+};
+
+// Checks ego trajectories in Frenet space against the predicted trajectories
+// of the other vehicles. Every vehicle is covered by CIRCLES circles spaced
+// along its length; the ego cover is turned along the direction of travel,
+// the others stay along s, as lateral speeds are small next to the
+// longitudinal ones. reset() keeps every manoeuvre at least
+// config.grid_min_probability likely once per frame; check() then culls the
+// ones whose s interval over the horizon does not come near the ego
+// trajectory's before testing the rest in one vectorized loop per ego point.
+// check() reuses the scratch space of reset(), so it can run many times per
+// cycle without allocating.
+class collision_checker {
+public:
+  static const int CIRCLES = 3;
+  static constexpr double VEHICLE_LENGTH = 5; // m
+  static constexpr double VEHICLE_WIDTH = 2; // m
+
+  // ego_s is where the ego car is at the start of the prediction; s values of
+  // later checks are taken on the lap nearest to it
+  void reset(const prediction_tensor &prediction, const sensor_fusion_frame &vehicles,
+             double ego_s, double max_s, const planner_config &config);
+
+  // Trajectory of count points, point i at start_time + i * dt seconds after
+  // the frame. Times outside the prediction use its first or last step.
+  collision_result check(const double *s, const double *d, int count, double start_time, double dt);
+
+private:
+  int step_count = 0;
+  int entry_count = 0; // vehicle and manoeuvre pairs kept by reset()
+  double start = 0;
+  double step_s = 1;
+  double reference_s = 0;
+  double track_length = 0;
+
+  // per entry, its trajectory as [step][entry] and its s interval
+  arena_vector<int> entry_id;
+  arena_vector<double> entry_s;
+  arena_vector<double> entry_d;
+  arena_vector<double> entry_s_min;
+  arena_vector<double> entry_s_max;
+
+  // entries left after the broad phase, laid out like the above
+  arena_vector<int> near;
+  arena_vector<double> near_s;
+  arena_vector<double> near_d;
+  arena_vector<double> near_clearance; // least squared distance of centers
+  arena_vector<double> near_closest; // time of the least distance
+  arena_vector<double> near_contact; // time of the first contact
+};
+
+#endif // COLLISION_CHECKER_H
@@ -0,0 +1,171 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include "stage_stats.h"
+
+// Number of lanes kept per record, lanes beyond it are not recorded
+const int RECORDED_LANES = 6;
+
+// Compact snapshot of one planning cycle. Floats are plenty for post-mortem
+// analysis and keep a record around 200 bytes.
+struct flight_record {
+  uint64_t seq; // odd while the record is being written
+  uint64_t cycle;
+  int64_t timestamp_ns; // system clock, to correlate with other logs
+
+  // ego telemetry
+  float car_x, car_y, car_s, car_d, car_yaw, car_speed;
+  float end_path_s;
+  int32_t prev_size;
+  int32_t vehicles;
+
+  // nearest cars ahead and behind per lane, after extrapolation
+  float leading_s[RECORDED_LANES], leading_speed[RECORDED_LANES];
+  float following_s[RECORDED_LANES], following_speed[RECORDED_LANES];
+
+  // decision
+  int8_t lane_from, lane_to, state, too_close;
+  int8_t near_miss, path_collision, path_rejected;
+  int8_t reply_lead; // points left out of the path for the reply latency
+  float speed_ref, speed_target;
+
+  uint32_t stage_ns[STAGE_COUNT];
+};
+
+// Why a dump was written
+enum flight_trigger {
+  TRIGGER_SIGNAL,
+  TRIGGER_NEAR_MISS,
+  TRIGGER_DEADLINE,
+  TRIGGER_DISCONNECT,
+  TRIGGER_COUNT
+};
+
+// Header written in front of the raw records of a dump
+struct flight_dump_header {
+  char magic[4]; // "PPFR"
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t capacity;
+  uint64_t head; // total records written, the newest one is at (head - 1) % capacity
+  uint32_t trigger;
+  uint32_t reserved;
+};
+
+// Fixed-size ring buffer of the last CAPACITY planning cycles.
+//
+// There is a single writer (the uWS event loop). Recording a cycle costs the
+// stores of the record itself plus two sequence stores; the reader side only
+// uses open/write/close, so dump() can be called from a signal handler. Records
+// being written while a dump happens are left with an odd seq and should be
+// ignored by the reader.
+template <int CAPACITY>
+class flight_recorder {
+public:
+  static const uint32_t VERSION = 2;
+
+  flight_recorder() : head(0) {
+    memset(records, 0, sizeof(records));
+  }
+
+  // Returns the slot for the next cycle. Fill it and call commit().
+  flight_record &begin(uint64_t cycle) {
+    flight_record &r = records[head.load(std::memory_order_relaxed) % CAPACITY];
+    r.seq++; // odd, in progress
+    std::atomic_signal_fence(std::memory_order_release);
+    r.cycle = cycle;
+    return r;
+  }
+
+  void commit(flight_record &r) {
+    std::atomic_signal_fence(std::memory_order_release);
+    r.seq++; // even, complete
+    head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Records a cycle summarized elsewhere, e.g. in planner_session::record
+  void record(const flight_record &r, uint64_t cycle) {
+    flight_record &slot = begin(cycle);
+    const size_t skipped = offsetof(flight_record, timestamp_ns); // seq and cycle
+    memcpy((char *)&slot + skipped, (const char *)&r + skipped, sizeof(flight_record) - skipped);
+    commit(slot);
+  }
+
+  uint64_t written() const { return head.load(std::memory_order_acquire); }
+
+  // Writes the header and the whole ring to path. Async-signal-safe.
+  bool dump(const char *path, flight_trigger trigger) const {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+      return false;
+    }
+    flight_dump_header header;
+    memcpy(header.magic, "PPFR", 4);
+    header.version = VERSION;
+    header.record_size = sizeof(flight_record);
+    header.capacity = CAPACITY;
+    header.head = head.load(std::memory_order_acquire);
+    header.trigger = trigger;
+    header.reserved = 0;
+    bool ok = write_all(fd, &header, sizeof(header)) &&
+              write_all(fd, records, sizeof(records));
+    close(fd);
+    return ok;
+  }
+
+  // Reads a dump back, oldest complete record first
+  static bool load(const char *path, std::vector<flight_record> &out, flight_dump_header &header) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+      return false;
+    }
+    bool ok = read(fd, &header, sizeof(header)) == sizeof(header) &&
+              memcmp(header.magic, "PPFR", 4) == 0 &&
+              header.record_size == sizeof(flight_record);
+    std::vector<flight_record> ring(ok ? header.capacity : 0);
+    if(ok) {
+      size_t bytes = ring.size() * sizeof(flight_record);
+      ok = read(fd, ring.data(), bytes) == (ssize_t)bytes;
+    }
+    close(fd);
+    if(!ok) {
+      return false;
+    }
+
+    out.clear();
+    uint64_t count = header.head < header.capacity ? header.head : header.capacity;
+    for(uint64_t i = header.head - count; i < header.head; i++) {
+      const flight_record &r = ring[i % header.capacity];
+      if((r.seq & 1) == 0) {
+        out.push_back(r);
+      }
+    }
+    return true;
+  }
+
+private:
+  static bool write_all(int fd, const void *data, size_t length) {
+    const char *p = (const char *)data;
+    while(length > 0) {
+      ssize_t n = write(fd, p, length);
+      if(n <= 0) {
+        return false;
+      }
+      p += n;
+      length -= n;
+    }
+    return true;
+  }
+
+  flight_record records[CAPACITY];
+  std::atomic<uint64_t> head;
+};
+
+#endif // FLIGHT_RECORDER_H
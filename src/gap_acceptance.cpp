@@ -0,0 +1,53 @@
+#include <math.h>
+#include "gap_acceptance.h"
+
+// Time to collision, required deceleration and distance of every vehicle,
+// with selects instead of branches
+static void gap_kernel(int n, double ego_s, double ego_speed, double max_s, double window,
+                       const double *__restrict predicted_s, const double *__restrict speed,
+                       double *__restrict distance, double *__restrict ttc,
+                       double *__restrict decel) {
+  const double half_lap = max_s / 2;
+  for(int i = 0; i < n; i++) {
+    double ds = predicted_s[i] - ego_s;
+    ds = ds > half_lap ? ds - max_s : ds;
+    ds = ds < -half_lap ? ds + max_s : ds;
+    double dist = fabs(ds);
+    double closing = ds > 0 ? ego_speed - speed[i] : speed[i] - ego_speed;
+    bool relevant = dist < window;
+    bool closes = relevant && closing > 0;
+    ttc[i] = closes ? dist / closing : INFINITY;
+    decel[i] = closes ? closing * closing / (2 * dist) : 0;
+    distance[i] = relevant ? dist : INFINITY;
+  }
+}
+
+void evaluate_gaps(const sensor_fusion_frame &vehicles, double ego_s, double ego_speed,
+                   double max_s, const planner_config &config, lane_gap_risk *lanes) {
+  int n = vehicles.size();
+  arena_vector<double> distance(n), ttc(n), decel(n);
+  gap_kernel(n, ego_s, ego_speed, max_s, config.gap_window,
+             vehicles[sensor_fusion_frame::PREDICTED_S], vehicles[sensor_fusion_frame::SPEED],
+             distance.data(), ttc.data(), decel.data());
+
+  const double *lane = vehicles[sensor_fusion_frame::LANE];
+  for(int l = 0; l < config.lanes; l++) {
+    lane_gap_risk risk = {INFINITY, INFINITY, 0};
+    for(int i = 0; i < n; i++) {
+      bool in_lane = lane[i] == l;
+      double d = in_lane ? distance[i] : INFINITY;
+      double t = in_lane ? ttc[i] : INFINITY;
+      double a = in_lane ? decel[i] : 0;
+      risk.distance = d < risk.distance ? d : risk.distance;
+      risk.ttc = t < risk.ttc ? t : risk.ttc;
+      risk.decel = a > risk.decel ? a : risk.decel;
+    }
+    lanes[l] = risk;
+  }
+}
+
+bool is_gap_acceptable(const lane_gap_risk &risk, const planner_config &config) {
+  return risk.distance > config.gap_min_distance &&
+         risk.ttc > config.gap_min_ttc &&
+         risk.decel < config.gap_max_decel;
+}
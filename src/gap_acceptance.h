@@ -0,0 +1,24 @@
+#ifndef GAP_ACCEPTANCE_H
+#define GAP_ACCEPTANCE_H
+
+#include "planner.h"
+#include "sensor_fusion.h"
+
+// How dangerous it is to be in a lane next to the cars around a position.
+// Cars ahead close in when we are faster, cars behind when they are.
+struct lane_gap_risk {
+  double distance; // smallest distance in s to a car of the lane, m
+  double ttc; // smallest time to collision, s; INFINITY if no car closes in
+  double decel; // largest deceleration needed to not close a gap, m/s^2
+};
+
+// Evaluates every lane against every vehicle of the frame in one pass. Needs
+// the predicted s and lanes of vehicles.bin_and_extrapolate(); ego_s and
+// ego_speed are for the same point in time. Writes config.lanes entries.
+void evaluate_gaps(const sensor_fusion_frame &vehicles, double ego_s, double ego_speed,
+                   double max_s, const planner_config &config, lane_gap_risk *lanes);
+
+// Whether a gap is large enough to move into, see the gap_* settings
+bool is_gap_acceptable(const lane_gap_risk &risk, const planner_config &config);
+
+#endif // GAP_ACCEPTANCE_H
@@ -0,0 +1,195 @@
+#include <math.h>
+#include <fstream>
+#include <sstream>
+#include "highway_map.h"
+
+double distance(double x1, double y1, double x2, double y2) {
+	return sqrt((x2-x1)*(x2-x1)+(y2-y1)*(y2-y1));
+}
+
+int ClosestWaypoint(double x, double y, const vector<double> &maps_x, const vector<double> &maps_y) {
+
+	double closestLen = 100000; //large number
+	int closestWaypoint = 0;
+
+	for(size_t i = 0; i < maps_x.size(); i++) {
+		double map_x = maps_x[i];
+		double map_y = maps_y[i];
+		double dist = distance(x,y,map_x,map_y);
+		if(dist < closestLen) {
+			closestLen = dist;
+			closestWaypoint = i;
+		}
+	}
+
+	return closestWaypoint;
+}
+
+int NextWaypoint(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y) {
+
+	int closestWaypoint = ClosestWaypoint(x,y,maps_x,maps_y);
+
+	double map_x = maps_x[closestWaypoint];
+	double map_y = maps_y[closestWaypoint];
+
+	double heading = atan2( (map_y-y),(map_x-x) );
+
+	double angle = fabs(theta-heading);
+	angle = min(2*pi() - angle, angle);
+
+	if(angle > pi()/4) {
+		// past the last waypoint the next one is the first
+		closestWaypoint = (closestWaypoint + 1) % maps_x.size();
+	}
+
+	return closestWaypoint;
+}
+
+// Transform from Cartesian x,y coordinates to Frenet s,d coordinates
+vector<double> getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y) {
+	int next_wp = NextWaypoint(x,y, theta, maps_x,maps_y);
+
+	int prev_wp;
+	prev_wp = next_wp-1;
+	if(next_wp == 0) {
+		prev_wp  = maps_x.size()-1;
+	}
+
+	double n_x = maps_x[next_wp]-maps_x[prev_wp];
+	double n_y = maps_y[next_wp]-maps_y[prev_wp];
+	double x_x = x - maps_x[prev_wp];
+	double x_y = y - maps_y[prev_wp];
+
+	// find the projection of x onto n
+	double proj_norm = (x_x*n_x+x_y*n_y)/(n_x*n_x+n_y*n_y);
+	double proj_x = proj_norm*n_x;
+	double proj_y = proj_norm*n_y;
+
+	double frenet_d = distance(x_x,x_y,proj_x,proj_y);
+
+	//see if d value is positive or negative by comparing it to a center point
+	double center_x = 1000-maps_x[prev_wp];
+	double center_y = 2000-maps_y[prev_wp];
+	double centerToPos = distance(center_x,center_y,x_x,x_y);
+	double centerToRef = distance(center_x,center_y,proj_x,proj_y);
+
+	if(centerToPos <= centerToRef) {
+		frenet_d *= -1;
+	}
+
+	// calculate s value
+	double frenet_s = 0;
+	for(int i = 0; i < prev_wp; i++) {
+		frenet_s += distance(maps_x[i],maps_y[i],maps_x[i+1],maps_y[i+1]);
+	}
+
+	frenet_s += distance(0,0,proj_x,proj_y);
+
+	return {frenet_s,frenet_d};
+}
+
+// Transform from Frenet s,d coordinates to Cartesian x,y
+vector<double> getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y) {
+	double x, y;
+	getXY(s, d, maps_s, maps_x, maps_y, x, y);
+	return {x,y};
+}
+
+void getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y, double &x, double &y) {
+	int prev_wp = -1;
+
+	while(prev_wp < (int)(maps_s.size()-1) && s > maps_s[prev_wp+1]) {
+		prev_wp++;
+	}
+
+	int wp2 = (prev_wp+1)%maps_x.size();
+
+	double heading = atan2((maps_y[wp2]-maps_y[prev_wp]),(maps_x[wp2]-maps_x[prev_wp]));
+	// the x,y,s along the segment
+	double seg_s = (s-maps_s[prev_wp]);
+
+	double seg_x = maps_x[prev_wp]+seg_s*cos(heading);
+	double seg_y = maps_y[prev_wp]+seg_s*sin(heading);
+
+	double perp_heading = heading-pi()/2;
+
+	x = seg_x + d*cos(perp_heading);
+	y = seg_y + d*sin(perp_heading);
+}
+
+void frenet_path(const highway_map &map, const double *x, const double *y, int n, double *s, double *d) {
+  if(n == 0) {
+    return;
+  }
+  const vector<double> &maps_x = map.waypoints_x;
+  const vector<double> &maps_y = map.waypoints_y;
+  int waypoints = maps_x.size();
+  double theta = n > 1 ? atan2(y[1] - y[0], x[1] - x[0]) : 0;
+  int next_wp = NextWaypoint(x[0], y[0], theta, maps_x, maps_y) % waypoints;
+  int prev_wp = (next_wp + waypoints - 1) % waypoints;
+  double lap = 0;
+  // NextWaypoint may pick a waypoint past the one that ends the segment the
+  // first point is on, so step back until the point is not before the start
+  // of its segment; from there the points only move forward
+  for(int walked = 0; walked < waypoints; walked++) {
+    double n_x = maps_x[next_wp] - maps_x[prev_wp];
+    double n_y = maps_y[next_wp] - maps_y[prev_wp];
+    double x_x = x[0] - maps_x[prev_wp];
+    double x_y = y[0] - maps_y[prev_wp];
+    if(x_x * n_x + x_y * n_y >= 0) {
+      break;
+    }
+    next_wp = prev_wp;
+    prev_wp = (prev_wp + waypoints - 1) % waypoints;
+  }
+  for(int i = 0; i < n; i++) {
+    double n_x = 0, n_y = 0, x_x = 0, x_y = 0, proj_norm = 0;
+    for(int walked = 0; walked < waypoints; walked++) {
+      n_x = maps_x[next_wp] - maps_x[prev_wp];
+      n_y = maps_y[next_wp] - maps_y[prev_wp];
+      x_x = x[i] - maps_x[prev_wp];
+      x_y = y[i] - maps_y[prev_wp];
+      proj_norm = (x_x * n_x + x_y * n_y) / (n_x * n_x + n_y * n_y);
+      if(proj_norm <= 1) {
+        break;
+      }
+      prev_wp = next_wp;
+      next_wp = (next_wp + 1) % waypoints;
+      if(prev_wp == 0) {
+        lap += map.max_s;
+      }
+    }
+    double length = sqrt(n_x * n_x + n_y * n_y);
+    s[i] = lap + map.waypoints_s[prev_wp] + proj_norm * length;
+    // positive to the right of the direction of travel, as in getXY
+    d[i] = (x_x * n_y - x_y * n_x) / length;
+  }
+}
+
+bool load_map(const string &map_file, highway_map &map) {
+  ifstream in_map_(map_file.c_str(), ifstream::in);
+  if(!in_map_) {
+    return false;
+  }
+
+  string line;
+  while (getline(in_map_, line)) {
+  	istringstream iss(line);
+  	double x;
+  	double y;
+  	float s;
+  	float d_x;
+  	float d_y;
+  	iss >> x;
+  	iss >> y;
+  	iss >> s;
+  	iss >> d_x;
+  	iss >> d_y;
+  	map.waypoints_x.push_back(x);
+  	map.waypoints_y.push_back(y);
+  	map.waypoints_s.push_back(s);
+  	map.waypoints_dx.push_back(d_x);
+  	map.waypoints_dy.push_back(d_y);
+  }
+  return true;
+}
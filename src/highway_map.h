@@ -0,0 +1,48 @@
+#ifndef HIGHWAY_MAP_H
+#define HIGHWAY_MAP_H
+
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// For converting back and forth between radians and degrees.
+constexpr double pi() { return M_PI; }
+inline double deg2rad(double x) { return x * pi() / 180; }
+inline double rad2deg(double x) { return x * 180 / pi(); }
+
+double distance(double x1, double y1, double x2, double y2);
+int ClosestWaypoint(double x, double y, const vector<double> &maps_x, const vector<double> &maps_y);
+int NextWaypoint(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y);
+
+// Transform from Cartesian x,y coordinates to Frenet s,d coordinates
+vector<double> getFrenet(double x, double y, double theta, const vector<double> &maps_x, const vector<double> &maps_y);
+
+// Transform from Frenet s,d coordinates to Cartesian x,y
+vector<double> getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y);
+void getXY(double s, double d, const vector<double> &maps_s, const vector<double> &maps_x, const vector<double> &maps_y, double &x, double &y);
+
+// Waypoints of the highway, see data/highway_map.csv
+struct highway_map {
+  vector<double> waypoints_x;
+  vector<double> waypoints_y;
+  vector<double> waypoints_s;
+  vector<double> waypoints_dx;
+  vector<double> waypoints_dy;
+  // The max s value before wrapping around the track back to 0
+  double max_s = 6945.554;
+
+  // s brought back onto the loop, in [0, max_s)
+  double wrap_s(double s) const { return s - max_s * floor(s / max_s); }
+};
+
+bool load_map(const string &map_file, highway_map &map);
+
+// Frenet s and d of the n points of a path driven forward. Walks the map
+// segments on from the first point's instead of searching all waypoints for
+// every point. The first s is in [0, max_s] and s keeps growing along the
+// path, past max_s where the path crosses the end of the loop.
+void frenet_path(const highway_map &map, const double *x, const double *y, int n, double *s, double *d);
+
+#endif // HIGHWAY_MAP_H
@@ -74,6 +74,12 @@ SOFTWARE.
     #pragma GCC diagnostic ignored "-Wfloat-equal"
 #endif
 
+// disable the false maybe-uninitialized warning of GCC 12 on the parser's
+// json_value swap; popped with the float-equal one above
+#if defined(__GNUC__) && !defined(__clang__)
+    #pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
 // disable documentation warnings on clang
 #if defined(__clang__)
     #pragma GCC diagnostic push
@@ -0,0 +1,102 @@
+#include <math.h>
+#include "Eigen-3.3/Eigen/Dense"
+#include "kalman_filter.h"
+
+namespace {
+
+typedef frenet_filter::covariance matrix3;
+
+const double LON_JERK = 2; // m/s^3, spread of the jerk the model leaves out
+const double LAT_JERK = 1; // m/s^3
+const double S_NOISE = 0.3; // m, standard deviation of an observed s
+const double SPEED_NOISE = 0.2; // m/s
+const double D_NOISE = 0.1; // m
+const double START_ACCEL = 2; // m/s^2, spread of the unknown acceleration of a new track
+const double START_D_RATE = 1; // m/s
+const double START_D_ACCEL = 1; // m/s^2
+
+// State transition over dt and the noise of a white jerk of the given spread
+void transition(double dt, double jerk, matrix3 &f, matrix3 &q) {
+  double dt2 = dt * dt;
+  double dt3 = dt2 * dt;
+  f << 1, dt, dt2 / 2,
+       0, 1, dt,
+       0, 0, 1;
+  q << dt3 * dt2 / 20, dt2 * dt2 / 8, dt3 / 6,
+       dt2 * dt2 / 8, dt3 / 3, dt2 / 2,
+       dt3 / 6, dt2 / 2, dt;
+  q *= jerk * jerk;
+}
+
+}
+
+kalman_bank::kalman_bank(int capacity) {
+  frenet_filter idle;
+  idle.lon.setZero();
+  idle.lon_cov.setZero();
+  idle.lat.setZero();
+  idle.lat_cov.setZero();
+  idle.observed = false;
+  idle.started = false;
+  idle.active = false;
+  filters.assign(capacity, idle);
+}
+
+void kalman_bank::start(int i, double s, double speed, double d) {
+  frenet_filter &filter = filters[i];
+  filter.lon << s, speed, 0;
+  filter.lon_cov.setZero();
+  filter.lon_cov.diagonal() << S_NOISE * S_NOISE, SPEED_NOISE * SPEED_NOISE, START_ACCEL * START_ACCEL;
+  filter.lat << d, 0, 0;
+  filter.lat_cov.setZero();
+  filter.lat_cov.diagonal() << D_NOISE * D_NOISE, START_D_RATE * START_D_RATE, START_D_ACCEL * START_D_ACCEL;
+  filter.observed = false;
+  filter.started = true;
+  filter.active = true;
+}
+
+void kalman_bank::observe(int i, double s, double speed, double d) {
+  frenet_filter &filter = filters[i];
+  filter.observed_s = s;
+  filter.observed_speed = speed;
+  filter.observed_d = d;
+  filter.observed = true;
+}
+
+void kalman_bank::step(double dt, double max_s) {
+  matrix3 lon_f, lon_q, lat_f, lat_q;
+  transition(dt > 0 ? dt : 0, LON_JERK, lon_f, lon_q);
+  transition(dt > 0 ? dt : 0, LAT_JERK, lat_f, lat_q);
+  Eigen::Matrix2d lon_r = Eigen::Vector2d(S_NOISE * S_NOISE, SPEED_NOISE * SPEED_NOISE).asDiagonal();
+
+  for(frenet_filter &filter : filters) {
+    if(!filter.active || filter.started) {
+      filter.started = false;
+      continue;
+    }
+    filter.lon = lon_f * filter.lon;
+    filter.lon_cov = lon_f * filter.lon_cov * lon_f.transpose() + lon_q;
+    filter.lat = lat_f * filter.lat;
+    filter.lat_cov = lat_f * filter.lat_cov * lat_f.transpose() + lat_q;
+
+    if(filter.observed) {
+      // s and speed are the first two states, so H picks rows and columns
+      Eigen::Vector2d innovation(filter.observed_s - filter.lon(0), filter.observed_speed - filter.lon(1));
+      innovation(0) -= max_s * floor(innovation(0) / max_s + 0.5);
+      Eigen::Matrix2d s = filter.lon_cov.topLeftCorner<2, 2>() + lon_r;
+      Eigen::Matrix<double, 3, 2> gain = filter.lon_cov.leftCols<2>() * s.inverse();
+      matrix3 lon_correction = gain * filter.lon_cov.topRows<2>();
+      filter.lon += gain * innovation;
+      filter.lon_cov -= lon_correction;
+
+      // d is the first state
+      double d_innovation = filter.observed_d - filter.lat(0);
+      Eigen::Vector3d d_gain = filter.lat_cov.col(0) / (filter.lat_cov(0, 0) + D_NOISE * D_NOISE);
+      matrix3 lat_correction = d_gain * filter.lat_cov.row(0);
+      filter.lat += d_gain * d_innovation;
+      filter.lat_cov -= lat_correction;
+      filter.observed = false;
+    }
+    filter.lon(0) -= max_s * floor(filter.lon(0) / max_s);
+  }
+}
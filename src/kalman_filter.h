@@ -0,0 +1,64 @@
+#ifndef KALMAN_FILTER_H
+#define KALMAN_FILTER_H
+
+#include <vector>
+// the vendored Eigen 3.3 trips a false -Wall positive of newer GCCs
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wint-in-bool-context"
+#include "Eigen-3.3/Eigen/Core"
+#pragma GCC diagnostic pop
+
+// Constant acceleration Kalman filter of one vehicle in Frenet coordinates:
+// [s, speed, acceleration] observed through s and speed, and [d, d rate,
+// d acceleration] observed through d. The two axes are filtered separately.
+struct frenet_filter {
+  typedef Eigen::Matrix<double, 3, 1> state;
+  typedef Eigen::Matrix<double, 3, 3> covariance;
+
+  state lon;
+  covariance lon_cov;
+  state lat;
+  covariance lat_cov;
+
+  // observation waiting for the next step
+  double observed_s;
+  double observed_speed;
+  double observed_d;
+  bool observed;
+  bool started; // since the last step, already at the time of the next one
+  bool active;
+};
+
+// A fixed number of filters, one per slot of a track table. Matrices are
+// fixed size and the bank is allocated once, so stepping it never touches
+// the heap; the transition and noise matrices are built once per step for
+// all filters.
+class kalman_bank {
+public:
+  explicit kalman_bank(int capacity);
+
+  // Starts filter i from a first observation
+  void start(int i, double s, double speed, double d);
+
+  // Observation of filter i for the next step
+  void observe(int i, double s, double speed, double d);
+
+  void stop(int i) { filters[i].active = false; }
+
+  // Moves filter from to slot to, stopping it at from
+  void move(int from, int to) {
+    filters[to] = filters[from];
+    filters[from].active = false;
+  }
+
+  // Predicts every active filter dt seconds ahead and corrects those
+  // observed since the last step. s wraps at max_s.
+  void step(double dt, double max_s);
+
+  const frenet_filter &operator[](int i) const { return filters[i]; }
+
+private:
+  std::vector<frenet_filter> filters;
+};
+
+#endif // KALMAN_FILTER_H
@@ -0,0 +1,127 @@
+#include <math.h>
+#include "lattice_search.h"
+
+namespace {
+
+const double SPEED_BIN = 1; // m/s, nodes closer in speed are merged
+const double ACCELERATIONS[] = {0, 2, -4}; // m/s^2, keeping speed first
+const double HEADWAY = 0.5; // s of following distance kept to the car ahead
+const double BRAKING_COST = 0.5; // m of progress given up per m/s of braking
+const double DELAY_COST = 0.1; // share of a lane change's cost added per step it is put off
+
+struct lattice_node {
+  int lane;
+  int first_lane;
+  double s; // relative to ego_s
+  double v;
+  double first_v;
+  double score;
+};
+
+// Whether the ego car at s (relative) with speed v at time t keeps its
+// headway to, and does not overlap, every car of the lane
+bool is_free(const occupancy_grid &grid, int lane, double ego_s, double s, double v, double t) {
+  double center = ego_s + s;
+  return !grid.any(grid.step_at(t), lane, center - occupancy_grid::VEHICLE_LENGTH / 2,
+                   center + occupancy_grid::VEHICLE_LENGTH / 2 + HEADWAY * v);
+}
+
+}
+
+lattice_plan search_lattice(const occupancy_grid &grid, int lane, double ego_s, double ego_speed,
+                            double max_speed, const planner_config &config) {
+  lattice_plan plan;
+  plan.found = false;
+  plan.first_lane = lane;
+  plan.first_speed = ego_speed;
+  plan.final_lane = lane;
+  plan.progress = 0;
+  plan.steps = 0;
+  plan.nodes = 0;
+
+  const int speed_bins = (int)(max_speed / SPEED_BIN) + 1;
+  const double dt = config.lattice_step_s;
+
+  // one layer per time step, the best node per (lane, speed bin) cell
+  arena_vector<lattice_node> layer, next;
+  arena_vector<int> cells(config.lanes * speed_bins);
+  lattice_node start = {lane, lane, 0, ego_speed, ego_speed, 0};
+  layer.push_back(start);
+
+  for(int step = 1; step <= config.lattice_steps; step++) {
+    double t0 = (step - 1) * dt;
+    double t1 = step * dt;
+    next.clear();
+    cells.assign(cells.size(), -1);
+    bool budget_left = true;
+
+    for(size_t n = 0; n < layer.size() && budget_left; n++) {
+      const lattice_node &node = layer[n];
+      for(int dl = -1; dl <= 1; dl++) {
+        int to_lane = node.lane + dl;
+        if(to_lane < 0 || to_lane >= config.lanes) {
+          continue;
+        }
+        // moving over needs the target lane free when we start to
+        if(dl != 0 && !is_free(grid, to_lane, ego_s, node.s, node.v, t0)) {
+          continue;
+        }
+        for(double a : ACCELERATIONS) {
+          if(++plan.nodes > config.lattice_node_budget) {
+            budget_left = false;
+            break;
+          }
+          double v = fmax(0.0, fmin(node.v + a * dt, max_speed));
+          double s = node.s + (node.v + v) / 2 * dt;
+          if(!is_free(grid, to_lane, ego_s, s, v, t1)) {
+            continue;
+          }
+          double change_cost = config.lattice_lane_change_cost * (1 + DELAY_COST * (step - 1));
+          double score = node.score + (s - node.s)
+                         - (dl != 0 ? change_cost : 0)
+                         - BRAKING_COST * fmax(0.0, node.v - v);
+          int &cell = cells[to_lane * speed_bins + (int)(v / SPEED_BIN)];
+          if(cell >= 0 && next[cell].score >= score) {
+            continue;
+          }
+          lattice_node child = {to_lane, step == 1 ? to_lane : node.first_lane, s, v,
+                                step == 1 ? v : node.first_v, score};
+          if(cell >= 0) {
+            next[cell] = child;
+          } else {
+            cell = next.size();
+            next.push_back(child);
+          }
+        }
+        if(!budget_left) {
+          break;
+        }
+      }
+    }
+
+    if(next.empty()) {
+      break;
+    }
+    layer.swap(next);
+    plan.steps = step;
+    if(!budget_left) {
+      break;
+    }
+  }
+
+  if(plan.steps == 0) {
+    return plan;
+  }
+  const lattice_node *best = &layer[0];
+  for(const lattice_node &node : layer) {
+    if(node.score > best->score) {
+      best = &node;
+    }
+  }
+  plan.found = true;
+  plan.first_lane = best->first_lane;
+  plan.first_speed = best->first_v;
+  plan.final_lane = best->lane;
+  plan.progress = best->s;
+  return plan;
+}
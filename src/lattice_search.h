@@ -0,0 +1,27 @@
+#ifndef LATTICE_SEARCH_H
+#define LATTICE_SEARCH_H
+
+#include "occupancy_grid.h"
+#include "planner.h"
+
+// Best manoeuvre found over the (lane, s, v) lattice
+struct lattice_plan {
+  bool found; // false if every first move was unsafe
+  int first_lane; // lane after the first step
+  double first_speed; // speed after the first step, m/s
+  int final_lane; // lane at the end of the horizon
+  double progress; // s gained over the horizon, m
+  int steps; // time steps searched before the budget ran out
+  int nodes; // nodes expanded
+};
+
+// Dynamic programming over lanes and speeds at discrete time steps. From
+// every node the ego car keeps, brakes or accelerates while staying or moving
+// one lane over; nodes whose footprint and headway overlap a predicted car in
+// the grid are dropped, and of the nodes reaching the same lane and speed bin
+// only the best survives. Stops early after config.lattice_node_budget
+// expansions. The grid starts at the time of ego_s.
+lattice_plan search_lattice(const occupancy_grid &grid, int lane, double ego_s, double ego_speed,
+                            double max_speed, const planner_config &config);
+
+#endif // LATTICE_SEARCH_H
@@ -0,0 +1,100 @@
+#include <math.h>
+#include <algorithm>
+#include "occupancy_grid.h"
+
+namespace {
+
+// Bits [from, to] of a word, 0 <= from <= to < 64
+inline uint64_t bit_mask(int from, int to) {
+  uint64_t upper = to == 63 ? ~0ull : (1ull << (to + 1)) - 1;
+  return upper & ~((1ull << from) - 1);
+}
+
+}
+
+void occupancy_grid::build(const prediction_tensor &prediction, double ego_s, double max_s,
+                           const planner_config &config) {
+  step_count = prediction.steps();
+  lanes = config.lanes;
+  cell = config.grid_cell_m;
+  bins = (int)ceil((config.grid_behind_m + config.grid_ahead_m) / cell);
+  words = (bins + 63) / 64;
+  track_length = max_s;
+  origin = ego_s - config.grid_behind_m;
+  origin -= floor(origin / max_s) * max_s;
+  step_s = prediction.step_time(1) - prediction.step_time(0);
+  bits.assign(step_count * lanes * words, 0);
+
+  const double half_length = VEHICLE_LENGTH / 2;
+  const double half_width = VEHICLE_WIDTH / 2;
+  for(int m = 0; m < MANOEUVRE_COUNT; m++) {
+    const double *probability = prediction.probability((manoeuvre)m);
+    for(int step = 0; step < step_count; step++) {
+      const double *s = prediction.s(step, (manoeuvre)m);
+      const double *d = prediction.d(step, (manoeuvre)m);
+      for(int i = 0; i < prediction.vehicles(); i++) {
+        if(probability[i] < config.grid_min_probability) {
+          continue;
+        }
+        double rear = offset_of(s[i] - half_length);
+        int b0 = (int)floor(rear / cell);
+        int b1 = (int)floor((rear + VEHICLE_LENGTH) / cell);
+        if(b1 < 0 || b0 >= bins) {
+          continue;
+        }
+        int l0 = max(0, (int)floor((d[i] - half_width) / config.lane_width));
+        int l1 = min(lanes - 1, (int)floor((d[i] + half_width) / config.lane_width));
+        for(int lane = l0; lane <= l1; lane++) {
+          set_range(step, lane, max(b0, 0), min(b1, bins - 1));
+        }
+      }
+    }
+  }
+}
+
+double occupancy_grid::offset_of(double s) const {
+  double rel = s - origin;
+  rel -= floor(rel / track_length) * track_length;
+  // just behind the window is negative, not a lap ahead
+  return rel > track_length / 2 ? rel - track_length : rel;
+}
+
+void occupancy_grid::set_range(int step, int lane, int b0, int b1) {
+  uint64_t *words_of_row = bits.data() + (step * lanes + lane) * words;
+  for(int w = b0 / 64; w <= b1 / 64; w++) {
+    int from = w == b0 / 64 ? b0 % 64 : 0;
+    int to = w == b1 / 64 ? b1 % 64 : 63;
+    words_of_row[w] |= bit_mask(from, to);
+  }
+}
+
+int occupancy_grid::step_at(double t) const {
+  int step = (int)floor(t / step_s + 0.5);
+  return max(0, min(step, step_count - 1));
+}
+
+bool occupancy_grid::occupied(int step, int lane, double s) const {
+  int b = (int)floor(offset_of(s) / cell);
+  if(b < 0 || b >= bins) {
+    return false;
+  }
+  return (row(step, lane)[b / 64] >> (b % 64)) & 1;
+}
+
+bool occupancy_grid::any(int step, int lane, double s0, double s1) const {
+  double start = offset_of(s0);
+  int b0 = max((int)floor(start / cell), 0);
+  int b1 = min((int)floor((start + s1 - s0) / cell), bins - 1);
+  if(s1 < s0 || b0 > b1) {
+    return false;
+  }
+  const uint64_t *words_of_row = row(step, lane);
+  for(int w = b0 / 64; w <= b1 / 64; w++) {
+    int from = w == b0 / 64 ? b0 % 64 : 0;
+    int to = w == b1 / 64 ? b1 % 64 : 63;
+    if(words_of_row[w] & bit_mask(from, to)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,56 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <stdint.h>
+#include "arena.h"
+#include "planner.h"
+#include "prediction.h"
+
+// Where the other vehicles are predicted to be, as one bitset of s bins per
+// lane and time step. The bins cover a window from config.grid_behind_m
+// behind to config.grid_ahead_m ahead of the ego car and wrap at max_s, so a
+// collision check is a few word tests instead of a loop over vehicles.
+// Rebuilt every frame in the cycle's arena; the time steps are those of the
+// prediction.
+class occupancy_grid {
+public:
+  // Footprint marked for every vehicle, m
+  static constexpr double VEHICLE_LENGTH = 5;
+  static constexpr double VEHICLE_WIDTH = 2;
+
+  // Marks the footprint of every vehicle under every manoeuvre that is at
+  // least config.grid_min_probability likely, at every predicted step.
+  // ego_s is at the start time of the prediction.
+  void build(const prediction_tensor &prediction, double ego_s, double max_s,
+             const planner_config &config);
+
+  int steps() const { return step_count; }
+
+  // The step nearest to t seconds after the start of the prediction,
+  // clamped to the horizon
+  int step_at(double t) const;
+
+  // Whether anything is at s in the lane; s outside the window is free
+  bool occupied(int step, int lane, double s) const;
+
+  // Whether anything is in [s0, s1] in the lane, as far as the window sees
+  bool any(int step, int lane, double s0, double s1) const;
+
+private:
+  // s relative to the window start, negative just behind it
+  double offset_of(double s) const;
+  const uint64_t *row(int step, int lane) const { return bits.data() + (step * lanes + lane) * words; }
+  void set_range(int step, int lane, int b0, int b1);
+
+  int step_count = 0;
+  int lanes = 0;
+  int bins = 0;
+  int words = 0; // per row
+  double origin = 0; // s of bin 0
+  double cell = 1;
+  double track_length = 0;
+  double step_s = 1;
+  arena_vector<uint64_t> bits;
+};
+
+#endif // OCCUPANCY_GRID_H
@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include "occupancy_index.h"
+
+using namespace std;
+
+static bool by_s(const indexed_vehicle &a, const indexed_vehicle &b) {
+  return a.s < b.s;
+}
+
+double occupancy_index::wrap(double s) const {
+  s = fmod(s, max_s);
+  return s < 0 ? s + max_s : s;
+}
+
+void occupancy_index::reset(int lanes, double track_length) {
+  lane_count = lanes;
+  max_s = track_length;
+  added.clear();
+  sorted.clear();
+  lane_start.assign(lanes + 1, 0);
+}
+
+void occupancy_index::add(int lane, double s, double speed, int id) {
+  if(lane < 0 || lane >= lane_count) {
+    return;
+  }
+  indexed_vehicle v;
+  v.s = wrap(s);
+  v.speed = speed;
+  v.id = id;
+  v.lane = lane;
+  added.push_back(v);
+}
+
+void occupancy_index::build() {
+  // counting sort by lane, then sort every lane by s
+  lane_start.assign(lane_count + 1, 0);
+  for(const indexed_vehicle &v : added) {
+    lane_start[v.lane + 1]++;
+  }
+  for(int l = 0; l < lane_count; l++) {
+    lane_start[l + 1] += lane_start[l];
+  }
+  sorted.resize(added.size());
+  arena_vector<int> next(lane_start.begin(), lane_start.end() - 1);
+  for(const indexed_vehicle &v : added) {
+    sorted[next[v.lane]++] = v;
+  }
+  for(int l = 0; l < lane_count; l++) {
+    sort(sorted.begin() + lane_start[l], sorted.begin() + lane_start[l + 1], by_s);
+  }
+}
+
+vehicle_range occupancy_index::lane(int l) const {
+  vehicle_range r;
+  r.begin = sorted.data() + lane_start[l];
+  r.end = sorted.data() + lane_start[l + 1];
+  return r;
+}
+
+lane_gap occupancy_index::gap(int l, double s) const {
+  lane_gap g;
+  vehicle_range r = lane(l);
+  if(r.size() == 0) {
+    g.leader = g.follower = nullptr;
+    g.ahead = g.behind = INFINITY;
+    return g;
+  }
+  indexed_vehicle key;
+  key.s = wrap(s);
+  const indexed_vehicle *after = upper_bound(r.begin, r.end, key, by_s);
+
+  g.leader = after == r.end ? r.begin : after;
+  g.follower = after == r.begin ? r.end - 1 : after - 1;
+  g.ahead = wrap(g.leader->s - key.s);
+  if(g.ahead == 0) {
+    // only one vehicle and it is exactly at s
+    g.ahead = max_s;
+  }
+  g.behind = wrap(key.s - g.follower->s);
+  return g;
+}
+
+int occupancy_index::in_interval(int l, double s0, double s1, vehicle_range out[2]) const {
+  vehicle_range r = lane(l);
+  if(s1 < s0 || r.size() == 0) {
+    return 0;
+  }
+  indexed_vehicle lo, hi;
+  if(s1 - s0 >= max_s) {
+    out[0] = r;
+    return 1;
+  }
+  lo.s = wrap(s0);
+  hi.s = wrap(s1);
+  if(lo.s <= hi.s) {
+    out[0].begin = lower_bound(r.begin, r.end, lo, by_s);
+    out[0].end = upper_bound(r.begin, r.end, hi, by_s);
+    return out[0].size() > 0 ? 1 : 0;
+  }
+  // the interval wraps: [lo, max_s) and [0, hi]
+  int n = 0;
+  vehicle_range tail = {lower_bound(r.begin, r.end, lo, by_s), r.end};
+  vehicle_range head = {r.begin, upper_bound(r.begin, r.end, hi, by_s)};
+  if(tail.size() > 0) out[n++] = tail;
+  if(head.size() > 0) out[n++] = head;
+  return n;
+}
+
+int occupancy_index::count_in_interval(int l, double s0, double s1) const {
+  vehicle_range ranges[2];
+  int n = in_interval(l, s0, s1, ranges);
+  int count = 0;
+  for(int i = 0; i < n; i++) {
+    count += ranges[i].size();
+  }
+  return count;
+}
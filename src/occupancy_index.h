@@ -0,0 +1,71 @@
+#ifndef OCCUPANCY_INDEX_H
+#define OCCUPANCY_INDEX_H
+
+#include "arena.h"
+
+// A vehicle as seen by the index, s already extrapolated to the planning time
+struct indexed_vehicle {
+  double s; // wrapped to [0, max_s)
+  double speed;
+  int id;
+  int lane;
+};
+
+// Nearest vehicles on both sides of a position in a lane. Distances are
+// measured along the loop, so a car just past max_s is still found ahead.
+struct lane_gap {
+  const indexed_vehicle *leader; // nullptr if the lane is empty
+  double ahead; // distance to the leader
+  const indexed_vehicle *follower; // nullptr if the lane is empty
+  double behind; // distance to the follower
+};
+
+// Contiguous run of vehicles of one lane, sorted by s
+struct vehicle_range {
+  const indexed_vehicle *begin;
+  const indexed_vehicle *end;
+  int size() const { return (int)(end - begin); }
+};
+
+// Per-frame index of the surrounding vehicles: one flat array grouped by lane
+// and sorted by s inside every lane. Building is O(n log n), every query is a
+// binary search in the lane plus the size of its answer. Storage comes from
+// the cycle's arena.
+class occupancy_index {
+public:
+  // Starts a new frame
+  void reset(int lanes, double max_s);
+
+  // Adds a vehicle; lanes outside [0, lanes) are ignored
+  void add(int lane, double s, double speed, int id);
+
+  // Sorts what was added. Queries are only valid after build().
+  void build();
+
+  int lanes() const { return lane_count; }
+  double length() const { return max_s; }
+  int size() const { return (int)sorted.size(); }
+  vehicle_range lane(int lane) const;
+
+  // Leader is the first vehicle with s greater than the given s, follower the
+  // last one at or before it, both wrapping around the track.
+  lane_gap gap(int lane, double s) const;
+
+  // Vehicles with s in [s0, s1], where s1 may be past max_s. Wrapping splits
+  // the answer in up to two ranges; returns how many were written to out.
+  int in_interval(int lane, double s0, double s1, vehicle_range out[2]) const;
+
+  // Number of vehicles with s in [s0, s1]
+  int count_in_interval(int lane, double s0, double s1) const;
+
+  double wrap(double s) const;
+
+private:
+  int lane_count = 0;
+  double max_s = 0;
+  arena_vector<indexed_vehicle> added;
+  arena_vector<indexed_vehicle> sorted;
+  arena_vector<int> lane_start; // lane l occupies [lane_start[l], lane_start[l + 1])
+};
+
+#endif // OCCUPANCY_INDEX_H
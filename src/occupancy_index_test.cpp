@@ -0,0 +1,143 @@
+// Checks the gap and interval queries of occupancy_index against a scan of
+// all cars, on a loop short enough that many of them span its end.
+//
+//   occupancy_index_test
+
+#include <math.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "occupancy_index.h"
+
+using namespace std;
+
+namespace {
+
+const double MAX_S = 1000; // m
+
+int failures = 0;
+
+void expect(bool passed, const string &what) {
+  if(!passed) {
+    cerr << what << endl;
+    failures++;
+  }
+}
+
+double wrap(double s) {
+  s = fmod(s, MAX_S);
+  return s < 0 ? s + MAX_S : s;
+}
+
+struct car {
+  int lane;
+  double s;
+};
+
+// Checks the gap and the intervals from s in lane against every car
+void check_queries(const occupancy_index &index, const vector<car> &cars, int lane, double s) {
+  string at = "lane " + to_string(lane) + " at " + to_string(s) + ": ";
+  double ahead = INFINITY, behind = INFINITY;
+  for(const car &c : cars) {
+    if(c.lane == lane) {
+      double d = wrap(c.s - s);
+      ahead = min(ahead, d > 0 ? d : MAX_S);
+      behind = min(behind, wrap(s - c.s));
+    }
+  }
+  lane_gap gap = index.gap(lane, s);
+  expect((gap.leader != nullptr) == (ahead < INFINITY), at + "leader found in an empty lane or missed");
+  expect(fabs(gap.ahead - ahead) < 1e-9 || gap.ahead == ahead, at + "leader " + to_string(gap.ahead) +
+         " m ahead, " + to_string(ahead) + " expected");
+  expect(fabs(gap.behind - behind) < 1e-9 || gap.behind == behind, at + "follower " +
+         to_string(gap.behind) + " m behind, " + to_string(behind) + " expected");
+  if(gap.leader) {
+    expect(fabs(wrap(gap.leader->s - s) - wrap(ahead)) < 1e-9, at + "leader is not the car ahead");
+  }
+
+  for(double length : {0.0, 15.0, 40.0, 480.0, 999.0}) {
+    int count = 0;
+    for(const car &c : cars) {
+      if(c.lane == lane && wrap(c.s - s) <= length) {
+        count++;
+      }
+    }
+    // s + length is past max_s for the cars near the end of the loop
+    vehicle_range ranges[2];
+    int n = index.in_interval(lane, s, s + length, ranges);
+    int found = 0;
+    for(int i = 0; i < n; i++) {
+      for(const indexed_vehicle *v = ranges[i].begin; v != ranges[i].end; v++) {
+        expect(wrap(v->s - s) <= length, at + "car at " + to_string(v->s) + " is not in " +
+               to_string(length) + " m");
+        found++;
+      }
+    }
+    expect(found == count, at + to_string(found) + " cars in " + to_string(length) + " m, " +
+           to_string(count) + " expected");
+    expect(index.count_in_interval(lane, s, s + length) == count, at + "count_in_interval differs");
+  }
+}
+
+}
+
+int main() {
+  occupancy_index index;
+
+  // cars on both sides of the end of the loop, one added past it
+  vector<car> cars = {{0, 10}, {0, 20}, {0, 990}, {0, 995}, {0, 500}, {1, 1002}, {1, 998}};
+  index.reset(3, MAX_S);
+  for(const car &c : cars) {
+    index.add(c.lane, c.s, 20, 0);
+  }
+  index.add(3, 100, 20, 0); // not a lane
+  index.build();
+  expect(index.size() == (int)cars.size(), "a car outside the lanes was indexed");
+  expect(index.lane(1).size() == 2 && index.lane(1).begin->s == 2, "s past the loop is not wrapped");
+
+  lane_gap gap = index.gap(0, 995.5);
+  expect(gap.leader && gap.leader->s == 10 && gap.ahead == 14.5, "the leader past the end of the loop is missed");
+  gap = index.gap(0, 1005);
+  expect(gap.leader && gap.leader->s == 10 && gap.follower && gap.follower->s == 995,
+         "a gap past the end of the loop is not around s - max_s");
+  gap = index.gap(2, 0);
+  expect(!gap.leader && !gap.follower && gap.ahead == INFINITY, "an empty lane has cars");
+
+  vehicle_range ranges[2];
+  expect(index.in_interval(0, 980, 1015, ranges) == 2 && ranges[0].size() == 2 && ranges[1].size() == 1,
+         "an interval over the end of the loop is not split in two");
+  expect(index.count_in_interval(0, -15, 15) == 3, "an interval from before 0 misses cars");
+  expect(index.count_in_interval(0, 0, 1000) == 5, "a whole lap misses cars");
+  expect(index.in_interval(0, 20, 10, ranges) == 0, "an interval that ends before it starts has cars");
+
+  // and a scan against every query on random scenes
+  uint32_t state = 7;
+  auto next = [&state](double range) {
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) / 16777216.0 * range;
+  };
+  for(int scene = 0; scene < 200; scene++) {
+    cars.clear();
+    int n = (int)next(12);
+    for(int i = 0; i < n; i++) {
+      // a few cars exactly at the end and the start of the loop
+      double s = i % 5 == 0 ? MAX_S * (i % 2) : next(1.2 * MAX_S) - 0.1 * MAX_S;
+      cars.push_back({(int)next(2), s});
+    }
+    index.reset(2, MAX_S);
+    for(const car &c : cars) {
+      index.add(c.lane, c.s, 20, 0);
+    }
+    index.build();
+    for(int query = 0; query < 20; query++) {
+      check_queries(index, cars, (int)next(2), query < 2 ? query * MAX_S : next(MAX_S));
+    }
+  }
+
+  if(failures > 0) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  cout << "PASSED" << endl;
+  return 0;
+}
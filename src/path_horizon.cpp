@@ -0,0 +1,21 @@
+#include <math.h>
+#include <algorithm>
+#include "path_horizon.h"
+
+using namespace std;
+
+namespace {
+
+const uint64_t STEP_NS = 20000000; // one simulator step
+
+}
+
+int path_horizon::update(int consumed, int min_points, int max_points, double lag_cycles) {
+  // only whole steps of planning count, so a replay plans the same paths
+  // however fast the machine is
+  double lag = consumed + (double)(latency_ns / STEP_NS);
+  peak_lag = max(lag, peak_lag * DECAY);
+  horizon = (int)ceil(lag_cycles * peak_lag);
+  horizon = min(max(horizon, min_points), max_points);
+  return horizon;
+}
@@ -0,0 +1,32 @@
+#ifndef PATH_HORIZON_H
+#define PATH_HORIZON_H
+
+#include <stdint.h>
+
+// Sizes the path sent to the simulator from how far behind the replies are.
+// Every cycle the lag is the points the simulator drove since our last reply
+// plus the whole simulator steps our previous cycle took to plan. The path
+// has to outlast horizon_lag_cycles of the largest recent lag: a lag spike
+// lengthens it at once, and it shrinks back slowly when replies are quick
+// again, keeping the planner responsive while it is idle.
+class path_horizon {
+public:
+  // Takes the points driven since the last reply and returns how many
+  // points the path should have, between min_points and max_points
+  int update(int consumed, int min_points, int max_points, double lag_cycles);
+
+  // Planning time of the cycle that just ended
+  void record_latency(uint64_t ns) { latency_ns = ns; }
+
+  double lag() const { return peak_lag; }
+  int points() const { return horizon; }
+
+  static constexpr double DECAY = 0.98; // of the peak lag per cycle
+
+private:
+  uint64_t latency_ns = 0;
+  double peak_lag = 0; // points
+  int horizon = 0;
+};
+
+#endif // PATH_HORIZON_H
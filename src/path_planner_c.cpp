@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <memory>
+#include "path_planner_c.h"
+#include "planner.h"
+
+struct path_planner_map {
+  highway_map map;
+  planner_config config;
+  int max_points;
+};
+
+struct path_planner_session {
+  explicit path_planner_session(const path_planner_map &map)
+    : max_points(map.max_points), planner(map.map, map.config) {}
+
+  int max_points;
+  planner_session planner;
+  monotonic_arena arena; // reset at the start of every cycle
+};
+
+path_planner_map *path_planner_map_load(const char *map_file, const char *config_file) {
+  try {
+    // owned here until it is complete, so a config that throws does not leak it
+    std::unique_ptr<path_planner_map> map(new path_planner_map);
+    if(!map_file || !load_map(map_file, map->map) ||
+       (config_file && !load_config(config_file, map->config))) {
+      return nullptr;
+    }
+    map->max_points = std::min(map->config.horizon_max_points, PATH_RING_CAPACITY);
+    return map.release();
+  } catch(...) {
+    return nullptr;
+  }
+}
+
+void path_planner_map_destroy(path_planner_map *map) {
+  delete map;
+}
+
+int path_planner_max_points(const path_planner_map *map) {
+  return map ? map->max_points : 0;
+}
+
+path_planner_session *path_planner_session_create(const path_planner_map *map) {
+  if(!map) {
+    return nullptr;
+  }
+  // the members allocate as well, so not only new itself may throw
+  try {
+    return new path_planner_session(*map);
+  } catch(...) {
+    return nullptr;
+  }
+}
+
+void path_planner_session_destroy(path_planner_session *session) {
+  delete session;
+}
+
+int path_planner_plan(path_planner_session *session, const path_planner_ego *ego,
+                      const path_planner_previous_path *previous,
+                      const path_planner_sensor_fusion *sensor_fusion, path_planner_path *out) {
+  if(!session || !ego || !previous || !out || !out->x || !out->y ||
+     (previous->size > 0 && (!previous->x || !previous->y)) ||
+     (sensor_fusion && sensor_fusion->vehicles > 0 && !sensor_fusion->rows)) {
+    return PATH_PLANNER_ERROR_ARGUMENT;
+  }
+  // no more points can be left than fit the session's copy of the path
+  if(previous->size < 0 || previous->size > PATH_RING_CAPACITY ||
+     (sensor_fusion && sensor_fusion->vehicles < 0)) {
+    return PATH_PLANNER_ERROR_ARGUMENT;
+  }
+  // checked up front, so a cycle is never planned and then not sent
+  int needed = std::max(session->max_points, previous->size);
+  if(out->capacity < needed) {
+    out->size = needed;
+    return PATH_PLANNER_ERROR_CAPACITY;
+  }
+
+  telemetry_frame frame;
+  frame.x = ego->x;
+  frame.y = ego->y;
+  frame.s = ego->s;
+  frame.d = ego->d;
+  frame.yaw = ego->yaw;
+  frame.speed = ego->speed;
+  frame.received_ns = ego->received_ns;
+  frame.planning_ns = ego->planning_ns;
+  frame.previous_x = previous->x;
+  frame.previous_y = previous->y;
+  frame.previous_size = previous->size;
+  frame.end_path_s = previous->end_s;
+  frame.end_path_d = previous->end_d;
+  frame.sensor_fusion = sensor_fusion ? sensor_fusion->rows : nullptr;
+  frame.vehicles = sensor_fusion ? sensor_fusion->vehicles : 0;
+
+  try {
+    arena_scope scope(session->arena);
+    planned_path path;
+    plan(frame, session->planner, path);
+    int size = path.x.size();
+    std::copy(path.x.begin(), path.x.end(), out->x);
+    std::copy(path.y.begin(), path.y.end(), out->y);
+    out->size = size;
+  } catch(...) {
+    return PATH_PLANNER_ERROR_INTERNAL;
+  }
+  return PATH_PLANNER_OK;
+}
@@ -0,0 +1,98 @@
+#ifndef PATH_PLANNER_C_H
+#define PATH_PLANNER_C_H
+
+/*
+ * C interface to the planner, for embedding it without JSON or websockets.
+ *
+ * A map handle holds the highway map and the planner config; it is read-only
+ * once loaded, so any number of sessions on any threads may share it. A
+ * session is one car's planner, with everything it keeps from one cycle to
+ * the next. Calls on one session must not overlap; different sessions may
+ * plan concurrently. Destroy the sessions before their map.
+ *
+ * path_planner_plan() reads the caller's input arrays in place and writes the
+ * path into the caller's output arrays; nothing is kept from either past the
+ * call. Everything else the cycle needs comes from the session's arena, so
+ * once the arena has grown to the size of a cycle planning does not touch
+ * the heap.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct path_planner_map path_planner_map;
+typedef struct path_planner_session path_planner_session;
+
+/* Where the car is, as the simulator reports it, and when */
+typedef struct {
+  double x;
+  double y;
+  double s;
+  double d;
+  double yaw; /* degrees */
+  double speed; /* MPH */
+  /* Steady clock time the frame arrived, in ns; 0 takes the start of the
+   * call. Only differences between frames count. */
+  int64_t received_ns;
+  /* How long planning takes in the clock of received_ns; -1 measures it. A
+   * caller on a simulated clock sets it, so the paths do not depend on how
+   * fast the machine is. */
+  int64_t planning_ns;
+} path_planner_ego;
+
+/* The points of the path returned last time that the car has not driven yet,
+ * at most 256 */
+typedef struct {
+  const double *x;
+  const double *y;
+  int size;
+  double end_s;
+  double end_d;
+} path_planner_previous_path;
+
+/* Rows of [id, x, y, vx, vy, s, d], one per other car on our side of the road */
+typedef struct {
+  const double *rows;
+  int vehicles;
+} path_planner_sensor_fusion;
+
+/* Caller-owned arrays of capacity points each; size is set to the points written */
+typedef struct {
+  double *x;
+  double *y;
+  int capacity;
+  int size;
+} path_planner_path;
+
+enum {
+  PATH_PLANNER_OK = 0,
+  PATH_PLANNER_ERROR_ARGUMENT = -1, /* a required pointer is missing or a count is out of range */
+  PATH_PLANNER_ERROR_CAPACITY = -2, /* the output is too small; size is the points needed */
+  PATH_PLANNER_ERROR_INTERNAL = -3
+};
+
+/* Loads the waypoint map and, if config_file is not NULL, the planner config.
+ * Returns NULL if either cannot be read. */
+path_planner_map *path_planner_map_load(const char *map_file, const char *config_file);
+void path_planner_map_destroy(path_planner_map *map);
+
+/* The largest path plan may return, to size the output arrays */
+int path_planner_max_points(const path_planner_map *map);
+
+path_planner_session *path_planner_session_create(const path_planner_map *map);
+void path_planner_session_destroy(path_planner_session *session);
+
+/* Plans one cycle and writes the path to drive into out. Returns one of the
+ * PATH_PLANNER_ codes. sensor_fusion may be NULL when there are no other cars. */
+int path_planner_plan(path_planner_session *session, const path_planner_ego *ego,
+                      const path_planner_previous_path *previous,
+                      const path_planner_sensor_fusion *sensor_fusion, path_planner_path *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PATH_PLANNER_C_H */
@@ -0,0 +1,274 @@
+/* Drives the C interface with a recorded corpus and checks that the paths are
+ * the golden output of the replay tool to its last digit, then that a car at
+ * a standstill moves off and that bad arguments are refused. Built as C, so
+ * it also checks that path_planner_c.h is C.
+ *
+ *   path_planner_c_test <map> <config> <corpus> <golden>
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "path_planner_c.h"
+
+#define MAX_LINE (1 << 20)
+#define MAX_VALUES 4096
+
+/* Where the value of "key" starts in line, or NULL */
+static const char *find_key(const char *line, const char *key) {
+  char pattern[64];
+  const char *found;
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  found = strstr(line, pattern);
+  return found ? found + strlen(pattern) : NULL;
+}
+
+static int read_number(const char *line, const char *key, double *value) {
+  const char *p = find_key(line, key);
+  if(!p) {
+    return 0;
+  }
+  *value = strtod(p, NULL);
+  return 1;
+}
+
+/* Every number of the array of "key", nested arrays flattened. Returns how
+ * many there are, or -1 if there is no such array or it has over max. */
+static int read_array(const char *line, const char *key, double *values, int max) {
+  const char *p = find_key(line, key);
+  int depth = 0;
+  int n = 0;
+  if(!p || *p != '[') {
+    return -1;
+  }
+  for(;;) {
+    if(*p == '[') {
+      depth++;
+      p++;
+    } else if(*p == ']') {
+      p++;
+      if(--depth == 0) {
+        return n;
+      }
+    } else if(*p == ',') {
+      p++;
+    } else {
+      char *end;
+      double value = strtod(p, &end);
+      if(end == p || n == max) {
+        return -1;
+      }
+      values[n++] = value;
+      p = end;
+    }
+  }
+}
+
+/* value with the digits the golden output has, as the replay's JSON prints it */
+static double golden_digits(double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.15g", value);
+  return strtod(text, NULL);
+}
+
+static int read_line(FILE *in, char *line) {
+  do {
+    if(!fgets(line, MAX_LINE, in)) {
+      return 0;
+    }
+  } while(line[0] == '\n');
+  return 1;
+}
+
+/* Plans every frame of the corpus in one session; returns the frames checked
+ * or -1 at the first difference */
+static int replay(path_planner_map *map, FILE *corpus, FILE *golden) {
+  static double previous_x[MAX_VALUES], previous_y[MAX_VALUES], rows[MAX_VALUES];
+  static double golden_x[MAX_VALUES], golden_y[MAX_VALUES];
+  char *line = malloc(MAX_LINE);
+  char *expected = malloc(MAX_LINE);
+  int capacity = path_planner_max_points(map);
+  double *out_x = malloc(capacity * sizeof(double));
+  double *out_y = malloc(capacity * sizeof(double));
+  path_planner_session *session = path_planner_session_create(map);
+  int frame = 0;
+  int result = -1;
+
+  while(session && read_line(corpus, line)) {
+    path_planner_ego ego;
+    path_planner_previous_path previous;
+    path_planner_sensor_fusion sensor_fusion;
+    path_planner_path out;
+    int golden_size, i;
+
+    if(!read_line(golden, expected)) {
+      fprintf(stderr, "golden output ends before frame %d\n", frame);
+      goto done;
+    }
+    if(!read_number(line, "x", &ego.x) || !read_number(line, "y", &ego.y) ||
+       !read_number(line, "s", &ego.s) || !read_number(line, "d", &ego.d) ||
+       !read_number(line, "yaw", &ego.yaw) || !read_number(line, "speed", &ego.speed) ||
+       !read_number(line, "end_path_s", &previous.end_s) ||
+       !read_number(line, "end_path_d", &previous.end_d)) {
+      fprintf(stderr, "frame %d is not telemetry\n", frame);
+      goto done;
+    }
+    previous.x = previous_x;
+    previous.y = previous_y;
+    previous.size = read_array(line, "previous_path_x", previous_x, MAX_VALUES);
+    if(read_array(line, "previous_path_y", previous_y, MAX_VALUES) != previous.size) {
+      fprintf(stderr, "frame %d has a broken previous path\n", frame);
+      goto done;
+    }
+    sensor_fusion.rows = rows;
+    sensor_fusion.vehicles = read_array(line, "sensor_fusion", rows, MAX_VALUES) / 7;
+
+    /* every frame arrives just as the reply to the last one lands and is
+     * planned in no time, as in the replay that wrote the golden output */
+    ego.received_ns = 1;
+    ego.planning_ns = 0;
+
+    out.x = out_x;
+    out.y = out_y;
+    out.capacity = capacity;
+    if(path_planner_plan(session, &ego, &previous, &sensor_fusion, &out) != PATH_PLANNER_OK) {
+      fprintf(stderr, "frame %d was not planned\n", frame);
+      goto done;
+    }
+
+    golden_size = read_array(expected, "next_x", golden_x, MAX_VALUES);
+    if(golden_size != out.size || read_array(expected, "next_y", golden_y, MAX_VALUES) != out.size) {
+      fprintf(stderr, "frame %d: %d points, golden has %d\n", frame, out.size, golden_size);
+      goto done;
+    }
+    for(i = 0; i < out.size; i++) {
+      if(golden_digits(out.x[i]) != golden_x[i] || golden_digits(out.y[i]) != golden_y[i]) {
+        fprintf(stderr, "frame %d: point %d is (%.15g, %.15g), golden has (%.15g, %.15g)\n", frame, i,
+              out.x[i], out.y[i], golden_x[i], golden_y[i]);
+        goto done;
+      }
+    }
+    frame++;
+  }
+  result = frame;
+
+done:
+  path_planner_session_destroy(session);
+  free(out_y);
+  free(out_x);
+  free(expected);
+  free(line);
+  return result;
+}
+
+/* A car held at a standstill: the previous path it sends back is one point
+ * over and over, which has no heading to go on from. Returns 1 unless it is
+ * planned to move off along the road. */
+static int check_standstill(path_planner_map *map) {
+  static double previous_x[5], previous_y[5], out_x[300], out_y[300];
+  path_planner_session *session = path_planner_session_create(map);
+  path_planner_ego ego = {909.48, 1128.67, 124.83, 6.16, 0, 0, 1, 0};
+  path_planner_previous_path previous = {previous_x, previous_y, 5, 124.83, 6.16};
+  path_planner_path out = {out_x, out_y, 300, 0};
+  int i, result;
+
+  for(i = 0; i < 5; i++) {
+    previous_x[i] = ego.x;
+    previous_y[i] = ego.y;
+  }
+  result = path_planner_plan(session, &ego, &previous, NULL, &out);
+  path_planner_session_destroy(session);
+  if(result != PATH_PLANNER_OK) {
+    fprintf(stderr, "a car at a standstill was not planned\n");
+    return 1;
+  }
+  /* it may only move off slowly, along the road */
+  for(i = 1; i < out.size; i++) {
+    double step = hypot(out_x[i] - out_x[i - 1], out_y[i] - out_y[i - 1]);
+    if(!(step < 0.5) || !(out_x[i] >= out_x[i - 1])) {
+      fprintf(stderr, "a car at a standstill moves %g m in step %d of its path\n", step, i);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Arguments the interface has to refuse; returns the number that it took */
+static int check_arguments(path_planner_map *map) {
+  static double points[300];
+  path_planner_session *session = path_planner_session_create(map);
+  path_planner_ego ego = {909.48, 1128.67, 124.83, 6.16, 0, 0};
+  path_planner_previous_path previous = {points, points, 0, 0, 0};
+  path_planner_sensor_fusion sensor_fusion = {NULL, 0};
+  path_planner_path out = {points, points, 1, 0};
+  int failures = 0;
+
+  if(path_planner_map_load("no such map", NULL) != NULL) {
+    fprintf(stderr, "a missing map loaded\n");
+    failures++;
+  }
+  if(path_planner_session_create(NULL) != NULL) {
+    fprintf(stderr, "a session was created without a map\n");
+    failures++;
+  }
+  if(path_planner_plan(session, NULL, &previous, &sensor_fusion, &out) != PATH_PLANNER_ERROR_ARGUMENT) {
+    fprintf(stderr, "planned without the ego car\n");
+    failures++;
+  }
+  if(path_planner_plan(session, &ego, &previous, &sensor_fusion, &out) != PATH_PLANNER_ERROR_CAPACITY ||
+     out.size != path_planner_max_points(map)) {
+    fprintf(stderr, "planned into an output of one point\n");
+    failures++;
+  }
+  out.capacity = 300;
+  previous.size = 257;
+  if(path_planner_plan(session, &ego, &previous, &sensor_fusion, &out) != PATH_PLANNER_ERROR_ARGUMENT) {
+    fprintf(stderr, "planned from a previous path of 257 points\n");
+    failures++;
+  }
+  previous.size = -1;
+  if(path_planner_plan(session, &ego, &previous, &sensor_fusion, &out) != PATH_PLANNER_ERROR_ARGUMENT) {
+    fprintf(stderr, "planned from a previous path of -1 points\n");
+    failures++;
+  }
+  previous.size = 0;
+  sensor_fusion.vehicles = -1;
+  if(path_planner_plan(session, &ego, &previous, &sensor_fusion, &out) != PATH_PLANNER_ERROR_ARGUMENT) {
+    fprintf(stderr, "planned with -1 other cars\n");
+    failures++;
+  }
+  path_planner_session_destroy(session);
+  return failures;
+}
+
+int main(int argc, char **argv) {
+  path_planner_map *map;
+  FILE *corpus, *golden;
+  int frames, failures;
+
+  if(argc != 5) {
+    fprintf(stderr, "Usage: %s <map> <config> <corpus> <golden>\n", argv[0]);
+    return 2;
+  }
+  map = path_planner_map_load(argv[1], argv[2]);
+  corpus = fopen(argv[3], "r");
+  golden = fopen(argv[4], "r");
+  if(!map || !corpus || !golden) {
+    fprintf(stderr, "Cannot read the map, config, corpus or golden output\n");
+    return 2;
+  }
+
+  frames = replay(map, corpus, golden);
+  failures = check_standstill(map) + check_arguments(map);
+  fclose(golden);
+  fclose(corpus);
+  path_planner_map_destroy(map);
+
+  if(frames < 0 || failures > 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("%d frames match the golden output\nPASSED\n", frames);
+  return 0;
+}
@@ -0,0 +1,27 @@
+#include "path_ring.h"
+
+path_ring::path_ring(int capacity) {
+  uint32_t size = 1;
+  while(size < (uint32_t)capacity) {
+    size <<= 1;
+  }
+  points.resize(size);
+  mask = size - 1;
+}
+
+void path_ring::consume(int n) {
+  n = n < count ? n : count;
+  if(n <= 0) {
+    return;
+  }
+  head = (head + n) & mask;
+  count -= n;
+}
+
+void path_ring::push(const path_point &point) {
+  if(full()) {
+    return;
+  }
+  points[(head + count) & mask] = point;
+  count++;
+}
@@ -0,0 +1,53 @@
+#ifndef PATH_RING_H
+#define PATH_RING_H
+
+#include <stdint.h>
+#include <vector>
+
+// One point of the path sent to the simulator
+struct path_point {
+  double x;
+  double y;
+  double s;
+  double d;
+  double v; // m/s, from the previous point
+  double t; // s of simulation since the start of the connection when the car is here
+};
+
+const int PATH_RING_CAPACITY = 256; // points, of the ring of every session
+
+// The points sent to the simulator that it has not driven yet, oldest first,
+// kept by the planner from one cycle to the next. A ring over a fixed power
+// of two capacity, so dropping the driven points and appending new ones
+// never moves or allocates anything.
+class path_ring {
+public:
+  explicit path_ring(int capacity = PATH_RING_CAPACITY);
+
+  int size() const { return count; }
+  int capacity() const { return mask + 1; }
+  bool full() const { return count == capacity(); }
+
+  // 0 is the next point the car drives to
+  const path_point &operator[](int i) const { return points[(head + i) & mask]; }
+  const path_point &back() const { return (*this)[count - 1]; }
+
+  // Drops the n oldest points, or all of them
+  void consume(int n);
+
+  // Appends a point, dropped if the ring is full
+  void push(const path_point &point);
+
+  // Drops the newest points past the first n
+  void truncate(int n) { count = n < count ? n : count; }
+
+  void clear() { count = 0; }
+
+private:
+  std::vector<path_point> points;
+  uint32_t mask;
+  uint32_t head = 0;
+  int count = 0;
+};
+
+#endif // PATH_RING_H
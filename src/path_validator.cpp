@@ -0,0 +1,108 @@
+#include "path_validator.h"
+
+namespace {
+
+const double STEP = 0.02; // s between two points
+
+// The kernels count in doubles: an int count of double comparisons mixes
+// vector widths, which GCC does not vectorize
+
+// Velocities between consecutive points, and how many are over max_speed
+int velocity_kernel(int n, double max_speed, const double *__restrict x, const double *__restrict y,
+                    double *__restrict vx, double *__restrict vy) {
+  double over = 0;
+  double limit = max_speed * max_speed;
+  for(int i = 0; i < n; i++) {
+    vx[i] = (x[i + 1] - x[i]) / STEP;
+    vy[i] = (y[i + 1] - y[i]) / STEP;
+    over += vx[i] * vx[i] + vy[i] * vy[i] > limit;
+  }
+  return (int)over;
+}
+
+// Accelerations over window steps of the velocities, and how many are over
+// the limits along and across the mean velocity of the window. Compared
+// squared and times the squared speed, so the projections need no division
+// by the speed.
+void accel_kernel(int n, int window, double max_tangential, double max_normal,
+                  const double *__restrict vx, const double *__restrict vy,
+                  double *__restrict ax, double *__restrict ay, int &tangential, int &normal) {
+  double over_tangential = 0;
+  double over_normal = 0;
+  double span = window * STEP;
+  double tangential_limit = max_tangential * max_tangential;
+  double normal_limit = max_normal * max_normal;
+  for(int i = 0; i < n; i++) {
+    double x = (vx[i + window] - vx[i]) / span;
+    double y = (vy[i + window] - vy[i]) / span;
+    double mean_x = (vx[i + window] + vx[i]) / 2;
+    double mean_y = (vy[i + window] + vy[i]) / 2;
+    double speed2 = mean_x * mean_x + mean_y * mean_y;
+    double along = x * mean_x + y * mean_y;
+    double across = x * mean_y - y * mean_x;
+    over_tangential += along * along > tangential_limit * speed2;
+    over_normal += across * across > normal_limit * speed2;
+    ax[i] = x;
+    ay[i] = y;
+  }
+  tangential = (int)over_tangential;
+  normal = (int)over_normal;
+}
+
+// Jerks over window steps of the accelerations that are over max_jerk
+int jerk_kernel(int n, int window, double max_jerk,
+                const double *__restrict ax, const double *__restrict ay) {
+  double over = 0;
+  double span = window * STEP;
+  double limit = max_jerk * max_jerk * span * span;
+  for(int i = 0; i < n; i++) {
+    double x = ax[i + window] - ax[i];
+    double y = ay[i + window] - ay[i];
+    over += x * x + y * y > limit;
+  }
+  return (int)over;
+}
+
+// Points whose d is outside [low, high], as a distance from its middle
+int road_kernel(int n, double low, double high, const double *__restrict d) {
+  double over = 0;
+  double middle = (low + high) / 2;
+  double half = (high - low) / 2;
+  for(int i = 0; i < n; i++) {
+    double off = d[i] - middle;
+    over += off * off > half * half;
+  }
+  return (int)over;
+}
+
+}
+
+path_check validate_path(const double *x, const double *y, const double *d, int n,
+                         const planner_config &config) {
+  path_check check = {0, 0, 0, 0, 0};
+  int window = config.validation_window;
+  int velocities = n - 1;
+  int accels = velocities - window;
+  int jerks = accels - window;
+
+  check.road = road_kernel(n, config.validation_road_margin,
+                           config.lanes * config.lane_width - config.validation_road_margin, d);
+  if(velocities <= 0) {
+    return check;
+  }
+  path_buffer vx(velocities);
+  path_buffer vy(velocities);
+  check.speed = velocity_kernel(velocities, config.validation_max_speed, x, y, vx.data(), vy.data());
+  if(accels <= 0) {
+    return check;
+  }
+  path_buffer ax(accels);
+  path_buffer ay(accels);
+  accel_kernel(accels, window, config.validation_max_tangential_accel,
+               config.validation_max_normal_accel, vx.data(), vy.data(), ax.data(), ay.data(),
+               check.tangential_accel, check.normal_accel);
+  if(jerks > 0) {
+    check.jerk = jerk_kernel(jerks, window, config.validation_max_jerk, ax.data(), ay.data());
+  }
+  return check;
+}
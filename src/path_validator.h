@@ -0,0 +1,28 @@
+#ifndef PATH_VALIDATOR_H
+#define PATH_VALIDATOR_H
+
+#include "planner.h"
+
+// Samples of a path over each limit of the validation; all 0 if it passed
+struct path_check {
+  int speed;
+  int tangential_accel;
+  int normal_accel;
+  int jerk;
+  int road; // points whose d is off the road
+
+  bool passed() const { return (speed | tangential_accel | normal_accel | jerk | road) == 0; }
+};
+
+// Checks the whole path about to be sent, as the simulator drives it one
+// point every 0.02 s, against the validation_* limits of config. Speed is
+// measured between consecutive points. Accelerations are the change of
+// velocity over validation_window steps, split along and across the
+// direction of travel, and jerk the change of that acceleration over the
+// same window, which is how the simulator averages them. Every measure is a
+// column of one vectorized loop and compared squared, so nothing is square
+// rooted; the only divisions are by the constant step and window span.
+path_check validate_path(const double *x, const double *y, const double *d, int n,
+                         const planner_config &config);
+
+#endif // PATH_VALIDATOR_H
@@ -0,0 +1,575 @@
+#include <math.h>
+#include <chrono>
+#include <fstream>
+#include "arena.h"
+#include "collision_checker.h"
+#include "gap_acceptance.h"
+#include "lattice_search.h"
+#include "occupancy_grid.h"
+#include "occupancy_index.h"
+#include "planner.h"
+#include "prediction.h"
+#include "sensor_fusion.h"
+#include "trajectory.h"
+
+
+const double MPH2MPS = 0.44704;
+const double HIGHEST_SPEED = 49.5 * MPH2MPS;
+const double SPEED_REPLAN = 0.25; // m/s the goal has to move by before the speed profile is planned again
+const double DISTANCE_THRESHOLD_PATH_PLANNING = 30; // if the other cars are 30 m or closer, take action
+const double DISTANCE_NEAR_MISS = 6; // another car this close in our lane is recorded as a near miss
+
+// Occupancy of one lane, rebuilt every cycle in the cycle's arena
+struct lane_occupancy {
+  neighboring_car leading; // Nearest car ahead
+  neighboring_car following; // Nearest car behind
+  int cars_ahead; // total leading cars in the lane
+  lane_gap_risk risk; // closing speeds of the cars around us
+};
+
+typedef arena_vector<lane_occupancy> lane_occupancies;
+
+// Initializing variables
+void initialize_lanes(lane_occupancies &lanes, int lane_count) {
+  lane_occupancy init_lane;
+  init_lane.following.s = -99999;
+  init_lane.following.speed = 0;
+  init_lane.leading.s = 99999;
+  init_lane.leading.speed = 0;
+  init_lane.cars_ahead = 0;
+
+  lanes.assign(lane_count, init_lane);
+}
+
+int find_lane(double d, const planner_config &config) {
+  int lane = (int)floor(d / config.lane_width);
+  return max(0, min(lane, config.lanes - 1));
+}
+
+// It makes sense to change lane only if the car in the target lane is further than the one in the current lane
+bool does_make_sense_to_change_lane(const lane_occupancies &lanes, int from_lane, int to_lane) {
+  return lanes[from_lane].leading.s < lanes[to_lane].leading.s;
+}
+
+// Decides if it is safe to change lane. Every lane crossed on the way needs
+// an acceptable gap and has to make sense to move on from.
+bool is_safe_change_lane(const lane_occupancies &lanes, int from_lane, int to_lane,
+                         const planner_config &config) {
+  int step = to_lane > from_lane ? 1 : -1;
+  for(int lane = from_lane; lane != to_lane; lane += step) {
+    if(!does_make_sense_to_change_lane(lanes, lane, to_lane) ||
+       !is_gap_acceptable(lanes[lane + step].risk, config)) {
+      return false;
+    }
+  }
+  return from_lane != to_lane;
+}
+
+bool load_config(const string &config_file, planner_config &config) {
+  ifstream in(config_file.c_str());
+  if(!in) {
+    return false;
+  }
+  json j = json::parse(in);
+  if(j.count("lanes")) config.lanes = j["lanes"];
+  if(j.count("lane_width")) config.lane_width = j["lane_width"];
+  if(j.count("gap_min_distance")) config.gap_min_distance = j["gap_min_distance"];
+  if(j.count("gap_min_ttc")) config.gap_min_ttc = j["gap_min_ttc"];
+  if(j.count("gap_max_decel")) config.gap_max_decel = j["gap_max_decel"];
+  if(j.count("gap_window")) config.gap_window = j["gap_window"];
+  if(j.count("lattice_steps")) config.lattice_steps = j["lattice_steps"];
+  if(j.count("lattice_step_s")) config.lattice_step_s = j["lattice_step_s"];
+  if(j.count("lattice_node_budget")) config.lattice_node_budget = j["lattice_node_budget"];
+  if(j.count("lattice_lane_change_cost")) config.lattice_lane_change_cost = j["lattice_lane_change_cost"];
+  if(j.count("prediction_steps")) config.prediction_steps = j["prediction_steps"];
+  if(j.count("prediction_step_s")) config.prediction_step_s = j["prediction_step_s"];
+  if(j.count("grid_cell_m")) config.grid_cell_m = j["grid_cell_m"];
+  if(j.count("grid_behind_m")) config.grid_behind_m = j["grid_behind_m"];
+  if(j.count("grid_ahead_m")) config.grid_ahead_m = j["grid_ahead_m"];
+  if(j.count("grid_min_probability")) config.grid_min_probability = j["grid_min_probability"];
+  if(j.count("speed_max_accel")) config.speed_max_accel = j["speed_max_accel"];
+  if(j.count("speed_max_jerk")) config.speed_max_jerk = j["speed_max_jerk"];
+  if(j.count("horizon_min_points")) config.horizon_min_points = j["horizon_min_points"];
+  if(j.count("horizon_max_points")) config.horizon_max_points = j["horizon_max_points"];
+  if(j.count("horizon_lag_cycles")) config.horizon_lag_cycles = j["horizon_lag_cycles"];
+  if(j.count("validation_max_speed")) config.validation_max_speed = j["validation_max_speed"];
+  if(j.count("validation_max_tangential_accel")) config.validation_max_tangential_accel = j["validation_max_tangential_accel"];
+  if(j.count("validation_max_normal_accel")) config.validation_max_normal_accel = j["validation_max_normal_accel"];
+  if(j.count("validation_max_jerk")) config.validation_max_jerk = j["validation_max_jerk"];
+  if(j.count("validation_window")) config.validation_window = j["validation_window"];
+  if(j.count("validation_road_margin")) config.validation_road_margin = j["validation_road_margin"];
+  config.speed_curve = s_curve_table(config.speed_max_accel, config.speed_max_jerk);
+  // the validator measures over validation_window steps and divides by it
+  return config.lanes > 0 && config.lane_width > 0 && config.validation_window > 0;
+}
+
+bool decode_telemetry(const telemetry_json &telemetry, path_buffer &storage, telemetry_frame &frame) {
+  frame.x = telemetry["x"];
+  frame.y = telemetry["y"];
+  frame.s = telemetry["s"];
+  frame.d = telemetry["d"];
+  frame.yaw = telemetry["yaw"];
+  frame.speed = telemetry["speed"];
+  frame.end_path_s = telemetry["end_path_s"];
+  frame.end_path_d = telemetry["end_path_d"];
+
+  const telemetry_json &previous_path_x = telemetry["previous_path_x"];
+  const telemetry_json &previous_path_y = telemetry["previous_path_y"];
+  const telemetry_json &sensor_fusion = telemetry["sensor_fusion"];
+  int prev_size = previous_path_x.size();
+  int vehicles = sensor_fusion.size();
+  // a longer path than the ring holds cannot be one we sent, and the two
+  // coordinates of every point are read together
+  if(prev_size > PATH_RING_CAPACITY || previous_path_y.size() != previous_path_x.size()) {
+    return false;
+  }
+  storage.resize(2 * prev_size + vehicles * telemetry_frame::SENSOR_FUSION_FIELDS);
+  double *values = storage.data();
+  for(int i = 0; i < prev_size; i++) {
+    values[i] = previous_path_x[i];
+    values[prev_size + i] = previous_path_y[i];
+  }
+  double *rows = values + 2 * prev_size;
+  int i = 0;
+  for(const telemetry_json &car : sensor_fusion) {
+    for(int k = 0; k < telemetry_frame::SENSOR_FUSION_FIELDS; k++) {
+      rows[i++] = car[k];
+    }
+  }
+  frame.previous_x = values;
+  frame.previous_y = values + prev_size;
+  frame.previous_size = prev_size;
+  frame.sensor_fusion = rows;
+  frame.vehicles = vehicles;
+  return true;
+}
+
+// Runs one planning cycle on a telemetry frame and fills the path to send
+// back to the simulator. Stage timings go to timer and a summary of the cycle
+// to record.
+static void plan_path(const telemetry_frame &telemetry, const highway_map &map,
+                      const planner_config &config, planner_state &session,
+                      stage_timer &timer, flight_record &record,
+                      path_buffer &next_x_vals, path_buffer &next_y_vals) {
+  int &lane_index = session.lane_index;
+  double &speed_ref = session.speed_ref;
+  double &speed_target = session.speed_target;
+
+  // Main car's localization Data
+  double car_x = telemetry.x;
+  double car_y = telemetry.y;
+  double car_s = telemetry.s;
+  double car_d = telemetry.d;
+  double car_yaw = telemetry.yaw;
+  double car_speed = telemetry.speed;
+
+  // Previous path's end s value
+  double end_path_s = telemetry.end_path_s;
+  timer.lap(STAGE_DECODE);
+
+  // Beggining of implementation
+  int prev_size = telemetry.previous_size;
+
+  // Our own copy of the path sent last cycle, less the points the simulator
+  // drove since; previous_path only tells how many those were. It is read
+  // again only if the two disagree, e.g. on the first frame of a connection.
+  path_ring &path = session.path;
+  int consumed = max(session.sent_points - prev_size, 0);
+  path.consume(consumed);
+  session.clock += consumed * 0.02;
+  int64_t received_ns = telemetry.received_ns;
+  if(!received_ns) {
+    received_ns = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count() - timer.since_start();
+  }
+  session.latency.frame_received(received_ns, consumed);
+  // since the last frame the simulator drove the points left out of our
+  // reply as well as those of it
+  int driven = consumed + session.lead_points;
+  int path_points = session.horizon.update(driven, config.horizon_min_points,
+                                           min(config.horizon_max_points, path.capacity()),
+                                           config.horizon_lag_cycles);
+  if(!matches_previous_path(path, telemetry.previous_x, telemetry.previous_y, prev_size)) {
+    path.clear();
+    append_path(path, telemetry.previous_x, telemetry.previous_y, prev_size, car_x, car_y,
+                session.clock, map);
+    if(prev_size > 0) {
+      session.profile.plan(path.back().t, path.back().v, 0, path.back().v, config.speed_curve);
+    }
+  }
+
+  // the path ends at this time and speed, new points continue from there
+  double path_end_time = prev_size > 0 ? path.back().t : session.clock;
+  speed_profile &profile = session.profile;
+  speed_ref = profile.speed(path_end_time, config.speed_curve);
+
+  record.timestamp_ns = chrono::duration_cast<chrono::nanoseconds>(
+      chrono::system_clock::now().time_since_epoch()).count();
+  record.car_x = car_x;
+  record.car_y = car_y;
+  record.car_s = car_s;
+  record.car_d = car_d;
+  record.car_yaw = car_yaw;
+  record.car_speed = car_speed;
+  record.end_path_s = end_path_s;
+  record.prev_size = prev_size;
+  record.vehicles = telemetry.vehicles;
+  record.near_miss = false;
+  record.path_collision = false;
+  record.path_rejected = false;
+  double ego_s = car_s;
+
+  // plan from the end of the path, where our copy has s already
+  if(prev_size > 0) {
+    car_s = map.wrap_s(path.back().s);
+  }
+
+  // flag indicating if we have a car in front of us and it is close enough to take action
+  bool too_close = false;
+  // speed to reach, by default the one we have
+  double speed_goal = speed_ref;
+
+  lane_index = find_lane(car_d, config);
+
+  // Depending on the current lane, which other lanes can we go to
+  lane_occupancies lanes;
+  initialize_lanes(lanes, config.lanes);
+
+  // Speed, lane and where the other cars are going to be after simulator
+  // processes the remaining points, for all of them at once
+  sensor_fusion_frame vehicles;
+  vehicles.ingest(telemetry.sensor_fusion, telemetry.vehicles);
+  vehicles.measure_speed();
+  const double *other_car_id = vehicles[sensor_fusion_frame::ID];
+  double *other_car_s = vehicles[sensor_fusion_frame::S];
+  double *other_car_speed = vehicles[sensor_fusion_frame::SPEED];
+  double *other_car_d = vehicles[sensor_fusion_frame::D];
+  double *other_car_accel = vehicles[sensor_fusion_frame::ACCEL];
+  double *other_car_d_rate = vehicles[sensor_fusion_frame::D_RATE];
+
+  // The simulator drove the points of the last path that are gone since.
+  // Every car is filtered by its track and planned with from the estimates.
+  double elapsed = driven * 0.02;
+  session.tracks.begin_frame(elapsed);
+  arena_vector<const vehicle_track *> tracks(vehicles.size());
+  for(int i = 0; i < vehicles.size(); i++) {
+    tracks[i] = session.tracks.update((int)other_car_id[i], other_car_s[i],
+                                      other_car_d[i], other_car_speed[i]);
+  }
+  session.tracks.filter(map.max_s);
+  for(int i = 0; i < vehicles.size(); i++) {
+    const vehicle_track *track = tracks[i];
+    if(track) {
+      other_car_s[i] = track->s;
+      other_car_d[i] = track->d;
+      other_car_speed[i] = track->speed;
+      other_car_accel[i] = track->accel;
+      other_car_d_rate[i] = track->d_rate;
+    }
+  }
+  session.tracks.age();
+
+  vehicles.bin_and_extrapolate(prev_size * 0.02, config);
+  const double *other_car_predicted_s = vehicles[sensor_fusion_frame::PREDICTED_S];
+  const double *other_car_lane = vehicles[sensor_fusion_frame::LANE];
+
+  // What the other cars may do from the end of the previous path on
+  prediction_tensor prediction;
+  prediction.predict(vehicles, prev_size * 0.02, config);
+  const double *change_left = prediction.probability(CHANGE_LEFT);
+  const double *change_right = prediction.probability(CHANGE_RIGHT);
+
+  // Index all cars on the road by lane and s. A car that is more likely than
+  // not moving over occupies the lane it goes to as well.
+  occupancy_index index;
+  index.reset(config.lanes, map.max_s);
+  for(int i = 0; i < vehicles.size(); i++) {
+    int id = (int)other_car_id[i];
+    int lane = (int)other_car_lane[i];
+    double ds = other_car_s[i] - ego_s;
+    ds -= map.max_s * floor(ds / map.max_s + 0.5); // nearest way round the loop
+    if(lane == lane_index && fabs(ds) < DISTANCE_NEAR_MISS) {
+      record.near_miss = true;
+    }
+    index.add(lane, other_car_predicted_s[i], other_car_speed[i], id);
+    if(change_left[i] > 0.5) {
+      index.add(lane - 1, other_car_predicted_s[i], other_car_speed[i], id);
+    }
+    if(change_right[i] > 0.5) {
+      index.add(lane + 1, other_car_predicted_s[i], other_car_speed[i], id);
+    }
+  }
+  index.build();
+
+  // and where every likely manoeuvre puts them over the next seconds
+  occupancy_grid grid;
+  grid.build(prediction, car_s, map.max_s, config);
+  collision_checker checker;
+  checker.reset(prediction, vehicles, car_s, map.max_s, config);
+
+  // On a loop every car is ahead and behind at once; count a car as ahead
+  // when it is less than half a lap in front of us.
+  double half_lap = map.max_s / 2;
+  for(int lane = 0; lane < config.lanes; lane++) {
+    lane_occupancy &occupancy = lanes[lane];
+    lane_gap gap = index.gap(lane, car_s);
+    if(gap.leader && gap.ahead <= half_lap) {
+      occupancy.leading.s = car_s + gap.ahead;
+      occupancy.leading.speed = gap.leader->speed;
+    }
+    if(gap.follower && gap.behind < half_lap) {
+      occupancy.following.s = car_s - gap.behind;
+      occupancy.following.speed = gap.follower->speed;
+    }
+    occupancy.cars_ahead = index.count_in_interval(lane, car_s, car_s + half_lap);
+  }
+
+  // Time to collision against every car, for all lanes at once. Our speed at
+  // the end of the previous path is the reference speed.
+  arena_vector<lane_gap_risk> risks(config.lanes);
+  evaluate_gaps(vehicles, car_s, speed_ref, map.max_s, config, risks.data());
+  for(int lane = 0; lane < config.lanes; lane++) {
+    lanes[lane].risk = risks[lane];
+  }
+
+  // Check to see if the car in front of us is too close
+  const lane_occupancy &own_lane = lanes[lane_index];
+  if(own_lane.leading.s - car_s < DISTANCE_THRESHOLD_PATH_PLANNING) {
+    too_close = true;
+    speed_target = own_lane.leading.speed;
+  }
+
+  timer.lap(STAGE_SENSOR_FUSION);
+
+  for(int i = 0; i < RECORDED_LANES; i++) {
+    bool known = i < config.lanes;
+    record.leading_s[i] = known ? lanes[i].leading.s : 0;
+    record.leading_speed[i] = known ? lanes[i].leading.speed : 0;
+    record.following_s[i] = known ? lanes[i].following.s : 0;
+    record.following_speed[i] = known ? lanes[i].following.speed : 0;
+  }
+  record.lane_from = lane_index;
+  record.too_close = too_close;
+
+  // TODO: consider a cost function for the middle lane to choose the lane which has no car or the car is farther or it is going faster.
+  // TODO: a good metric to choose a lane is the number of cars in that lane in front of us
+  // TODO: something to consider is if there are cars in front of us which are not still too close to do path planning but there is a lane which has no car in it, we should probably switch lane. So basically another threshold for path planning but more futuristic. Maybe we can switch lane if we find another lane which has no car in it (or less cars)
+
+  // Lanes next to ours, left one first; -1 if we are at the edge of the road
+  int left_lane = lane_index > 0 ? lane_index - 1 : -1;
+  int right_lane = lane_index < config.lanes - 1 ? lane_index + 1 : -1;
+  int adjacent_lanes[2] = {left_lane, right_lane};
+
+  // if we detected another car in our lane which is too close, consider changing lane
+  int target_lane = lane_index;
+  if(too_close) {
+    // consider a lane that has no car first
+    for(int lane : adjacent_lanes) {
+      if(lane >= 0 && lanes[lane].cars_ahead == 0 &&
+         is_safe_change_lane(lanes, lane_index, lane, config)) {
+        target_lane = lane;
+        break;
+      }
+    }
+    // otherwise look a few seconds ahead: move over now only if that is the
+    // start of the manoeuvre that gets us farthest, which may as well be to
+    // slow down and pass later
+    if(target_lane == lane_index) {
+      lattice_plan plan = search_lattice(grid, lane_index, car_s, speed_ref, HIGHEST_SPEED, config);
+      int lane = plan.first_lane;
+      if(plan.found && lane != lane_index && is_safe_change_lane(lanes, lane_index, lane, config)) {
+        target_lane = lane;
+      } else if(plan.found && plan.final_lane != lane_index) {
+        // slow down to slot in behind a car of the other lane
+        speed_target = min(speed_target, plan.first_speed);
+      }
+    }
+    if(target_lane == lane_index) {
+      // brake down to the speed of the car ahead, but never speed up to it
+      speed_goal = min(speed_target, speed_ref);
+    }
+  } else {
+    // see if any lane is empty to jump to
+    if(lanes[lane_index].cars_ahead != 0) {
+      for(int lane : adjacent_lanes) {
+        if(lane >= 0 && lanes[lane].cars_ahead == 0 &&
+           is_safe_change_lane(lanes, lane_index, lane, config)) {
+          target_lane = lane;
+          break;
+        }
+      }
+    }
+    speed_goal = HIGHEST_SPEED;
+  }
+
+  planning_state state = KL;
+  if(target_lane < lane_index) {
+    state = LCL;
+  } else if(target_lane > lane_index) {
+    state = LCR;
+  }
+  lane_index = target_lane;
+
+  // a new jerk-limited speed change from the end of the path, if the goal moved
+  if(fabs(speed_goal - profile.target()) > SPEED_REPLAN) {
+    profile.plan(path_end_time, speed_ref, profile.accel(path_end_time, config.speed_curve),
+                 speed_goal, config.speed_curve);
+  }
+  timer.lap(STAGE_LANE_DECISION);
+
+  record.lane_to = lane_index;
+  record.state = state;
+  record.speed_ref = speed_ref;
+  record.speed_target = speed_target;
+
+  // The points the simulator drives before our reply lands are left out of
+  // it at the end, see below, so the path is planned that much longer: what
+  // is sent must still last horizon_min_points, fallback paths included
+  int lead = min(session.latency.lead_points(), prev_size);
+  path_points = min(max(path_points, lead + config.horizon_min_points), path.capacity());
+  lead = max(min(lead, path_points - config.horizon_min_points), 0);
+
+  // First move over any remaining points from previous path
+  next_x_vals.clear();
+  next_y_vals.clear();
+  for(int i = 0; i < prev_size; i++) {
+    next_x_vals.push_back(path[i].x);
+    next_y_vals.push_back(path[i].y);
+  }
+
+  // generate remaining waypoints, and keep them with their Frenet coordinates
+  extend_path(map, config, session, prev_size, car_x, car_y, car_yaw, car_s, lane_index,
+              path_end_time, path_points - prev_size, next_x_vals, next_y_vals, &timer);
+  append_path(path, next_x_vals.data() + prev_size, next_y_vals.data() + prev_size,
+              next_x_vals.size() - prev_size, car_x, car_y, session.clock, map);
+
+  // The whole path must be drivable before it is sent. If it is not, the new
+  // points keep the lane the previous path ends in instead, and if even those
+  // fail they also hold the speed the previous path ends with. The previous
+  // path is never sent on its own: it may be shorter than what the car
+  // drives before the next reply lands.
+  record.path_rejected = !validate_path_ring(path, next_x_vals, next_y_vals, config).passed();
+  if(record.path_rejected) {
+    path.truncate(prev_size);
+    next_x_vals.resize(prev_size);
+    next_y_vals.resize(prev_size);
+    lane_index = find_lane(prev_size > 0 ? path[prev_size - 1].d : car_d, config);
+    record.lane_to = lane_index;
+    record.state = KL;
+    extend_path(map, config, session, prev_size, car_x, car_y, car_yaw, car_s, lane_index,
+                path_end_time, path_points - prev_size, next_x_vals, next_y_vals, nullptr);
+    append_path(path, next_x_vals.data() + prev_size, next_y_vals.data() + prev_size,
+                next_x_vals.size() - prev_size, car_x, car_y, session.clock, map);
+    if(prev_size > 0 && !validate_path_ring(path, next_x_vals, next_y_vals, config).passed()) {
+      path.truncate(prev_size);
+      next_x_vals.resize(prev_size);
+      next_y_vals.resize(prev_size);
+      profile.plan(path_end_time, speed_ref, 0, speed_ref, config.speed_curve);
+      extend_path(map, config, session, prev_size, car_x, car_y, car_yaw, car_s, lane_index,
+                  path_end_time, path_points - prev_size, next_x_vals, next_y_vals, nullptr);
+      append_path(path, next_x_vals.data() + prev_size, next_y_vals.data() + prev_size,
+                  next_x_vals.size() - prev_size, car_x, car_y, session.clock, map);
+    }
+  }
+
+  // Check the new points against the predictions; the points of the previous
+  // path were checked when they were new
+  int new_points = next_x_vals.size() - prev_size;
+  path_buffer path_s(new_points);
+  path_buffer path_d(new_points);
+  for(int i = 0; i < new_points; i++) {
+    path_s[i] = path[prev_size + i].s;
+    path_d[i] = path[prev_size + i].d;
+  }
+  collision_result collision = checker.check(path_s.data(), path_d.data(), new_points,
+                                             (prev_size + 1) * 0.02, 0.02);
+  record.path_collision = collision.collides;
+
+  // The simulator drives on along its old path until the reply lands, and
+  // then starts from the first point of ours: the points it will have
+  // driven by then are left out, so the path starts where the car will be.
+  next_x_vals.erase(next_x_vals.begin(), next_x_vals.begin() + lead);
+  next_y_vals.erase(next_y_vals.begin(), next_y_vals.begin() + lead);
+  path.consume(lead);
+  session.clock += lead * 0.02;
+  session.lead_points = lead;
+  record.reply_lead = min(lead, 127);
+
+  session.sent_points = next_x_vals.size();
+  timer.lap(STAGE_PATH_EMISSION);
+  int64_t planning_ns = telemetry.planning_ns >= 0 ? telemetry.planning_ns : (int64_t)timer.since_start();
+  session.horizon.record_latency(planning_ns);
+  session.latency.reply_sent(received_ns + planning_ns);
+}
+
+// Same, decoding the data of a "telemetry" event (j[1] of the message)
+// first; returns false without planning if it does not decode
+static bool plan_path(const telemetry_json &telemetry, const highway_map &map,
+                      const planner_config &config, planner_state &session,
+                      stage_timer &timer, flight_record &record,
+                      path_buffer &next_x_vals, path_buffer &next_y_vals) {
+  path_buffer storage;
+  telemetry_frame frame;
+  if(!decode_telemetry(telemetry, storage, frame)) {
+    return false;
+  }
+  plan_path(frame, map, config, session, timer, record, next_x_vals, next_y_vals);
+  return true;
+}
+
+// Counts what the planner decided in a cycle
+static void count_cycle(const flight_record &record, stage_stats &stats) {
+  stats.telemetry_frames++;
+  if(record.state == LCL) {
+    stats.lane_changes_left++;
+  } else if(record.state == LCR) {
+    stats.lane_changes_right++;
+  }
+  if(record.path_collision) {
+    stats.path_collisions++;
+  }
+  if(record.path_rejected) {
+    stats.path_rejections++;
+  }
+}
+
+// Ends a cycle that plan() timed itself
+static void finish_cycle(stage_timer &timer, flight_record &record) {
+  timer.finish();
+  for(int i = 0; i < STAGE_COUNT; i++) {
+    record.stage_ns[i] = timer.elapsed[i];
+  }
+}
+
+bool plan(const telemetry_json &telemetry, planner_session &session, planned_path &path,
+          stage_timer &timer) {
+  if(!plan_path(telemetry, session.map, session.config, session.state, timer, session.record,
+                path.x, path.y)) {
+    session.stats.malformed_frames++;
+    return false;
+  }
+  count_cycle(session.record, session.stats);
+  return true;
+}
+
+void plan(const telemetry_frame &telemetry, planner_session &session, planned_path &path,
+          stage_timer &timer) {
+  plan_path(telemetry, session.map, session.config, session.state, timer, session.record,
+            path.x, path.y);
+  count_cycle(session.record, session.stats);
+}
+
+bool plan(const telemetry_json &telemetry, planner_session &session, planned_path &path) {
+  stage_timer timer(session.stats);
+  if(!plan(telemetry, session, path, timer)) {
+    return false;
+  }
+  finish_cycle(timer, session.record);
+  return true;
+}
+
+void plan(const telemetry_frame &telemetry, planner_session &session, planned_path &path) {
+  stage_timer timer(session.stats);
+  plan(telemetry, session, path, timer);
+  finish_cycle(timer, session.record);
+}
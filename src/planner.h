@@ -0,0 +1,209 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <math.h>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "json.hpp"
+#include "stage_stats.h"
+#include "flight_recorder.h"
+#include "highway_map.h"
+#include "path_horizon.h"
+#include "path_ring.h"
+#include "reply_latency.h"
+#include "speed_profile.h"
+#include "track_table.h"
+
+using namespace std;
+
+// for convenience
+using json = nlohmann::json;
+
+// Telemetry is parsed into the arena of the cycle, see arena.h
+typedef nlohmann::basic_json<std::map, std::vector, std::string, bool, std::int64_t,
+                             std::uint64_t, double, arena_allocator> telemetry_json;
+
+// Points of the path sent back to the simulator
+typedef arena_vector<double> path_buffer;
+
+// The data of one "telemetry" event as plain arrays, which the planner only
+// reads during the cycle and does not keep
+struct telemetry_frame {
+  // Main car's localization data
+  double x;
+  double y;
+  double s;
+  double d;
+  double yaw; // degrees
+  double speed; // MPH
+
+  // Points of the previous path the simulator has not driven yet
+  const double *previous_x;
+  const double *previous_y;
+  int previous_size;
+
+  // Previous path's end s and d values
+  double end_path_s;
+  double end_path_d;
+
+  // Rows of [id, x, y, vx, vy, s, d] of all other cars on our side of the road
+  const double *sensor_fusion;
+  int vehicles;
+
+  // Steady clock time the frame arrived, in ns; 0 takes the start of the
+  // planning cycle. Only differences between frames count, so a client may
+  // use any clock that runs in real time.
+  int64_t received_ns = 0;
+
+  // How long the cycle takes in the clock of received_ns; -1 measures it. A
+  // client on a simulated clock sets it, so its replies do not depend on how
+  // fast the machine is.
+  int64_t planning_ns = -1;
+
+  static const int SENSOR_FUSION_FIELDS = 7;
+};
+
+// Copies the data of a "telemetry" event (j[1] of the message) into frame,
+// whose arrays then point into storage. Returns false, leaving frame
+// unspecified, if the previous path is longer than PATH_RING_CAPACITY or its
+// x and y differ in length.
+bool decode_telemetry(const telemetry_json &telemetry, path_buffer &storage, telemetry_frame &frame);
+
+// Road layout and tunables, see data/planner_config.json
+struct planner_config {
+  int lanes = 3; // lanes on our side of the road, numbered from the left
+  double lane_width = 4; // m
+
+  // A lane change needs every car of the target lane farther than
+  // gap_min_distance, more than gap_min_ttc seconds from closing the gap and
+  // a closing speed that less than gap_max_decel of braking takes away.
+  // Cars farther than gap_window do not count.
+  double gap_min_distance = 5; // m
+  double gap_min_ttc = 3; // s
+  double gap_max_decel = 3; // m/s^2
+  double gap_window = 100; // m
+
+  // Lane x time lattice searched when the car ahead is too close: steps of
+  // lattice_step_s out to lattice_steps, at most lattice_node_budget
+  // expansions, and a lane change costs as much as lattice_lane_change_cost
+  // of progress.
+  int lattice_steps = 5;
+  double lattice_step_s = 1; // s
+  int lattice_node_budget = 400;
+  double lattice_lane_change_cost = 5; // m
+
+  // Other vehicles are predicted prediction_steps steps of prediction_step_s
+  // past the end of the previous path
+  int prediction_steps = 10;
+  double prediction_step_s = 0.5; // s
+
+  // Occupancy grid of the predictions the lattice checks against: cells of
+  // grid_cell_m from grid_behind_m behind to grid_ahead_m ahead of the car,
+  // marking manoeuvres at least grid_min_probability likely
+  double grid_cell_m = 1; // m
+  double grid_behind_m = 32; // m
+  double grid_ahead_m = 224; // m
+  double grid_min_probability = 0.2;
+
+  // Limits of the speed changes of the ego car, and the S-curves they allow,
+  // sampled when the config is loaded
+  double speed_max_accel = 5; // m/s^2
+  double speed_max_jerk = 8; // m/s^3
+  s_curve_table speed_curve = s_curve_table(speed_max_accel, speed_max_jerk);
+
+  // The path sent is long enough for horizon_lag_cycles of the largest
+  // recent lag of the replies, but no shorter than horizon_min_points and no
+  // longer than horizon_max_points
+  int horizon_min_points = 25;
+  int horizon_max_points = 150;
+  double horizon_lag_cycles = 8;
+
+  // Limits every path is checked against before it is sent, see
+  // path_validator.h; accelerations and jerk are averaged over
+  // validation_window steps of 0.02 s, and the car has to stay
+  // validation_road_margin inside the edges of the road
+  double validation_max_speed = 22.35; // m/s
+  double validation_max_tangential_accel = 10; // m/s^2
+  double validation_max_normal_accel = 10; // m/s^2
+  double validation_max_jerk = 50; // m/s^3
+  int validation_window = 10;
+  double validation_road_margin = 1; // m
+};
+
+// Fills config from a json file; keys that are missing keep their defaults
+bool load_config(const string &config_file, planner_config &config);
+
+// We use only three states. Prepare lane change is discarded as we tend to do more sudden decisions here.
+enum planning_state {KL, LCL, LCR};
+
+// State kept by the planner from one cycle to the next
+struct planner_state {
+  int lane_index = 1; //left lane is 0, increasing to the right
+  double speed_ref = 0; // velocity at the end of the path (m/sec)
+  double speed_target = 0;
+  speed_profile profile; // speeds of the points appended to the path
+  int sent_points = 0; // length of the path sent last cycle
+  path_horizon horizon; // how long the path sent is
+  double clock = 0; // s of simulation driven since the start of the connection
+  reply_latency latency; // how late our replies land
+  int lead_points = 0; // points of the last reply left out for the latency
+
+  // the points sent that the simulator has not driven yet
+  path_ring path;
+
+  // the other vehicles across cycles, by sensor fusion id
+  track_table tracks;
+};
+
+struct neighboring_car {
+  double speed;
+  double s;
+};
+
+int find_lane(double d, const planner_config &config);
+
+// A connection's planner for in-process runs: the road and tunables it plans
+// with, what it keeps between cycles, and where it reports on them
+struct planner_session {
+  planner_session(const highway_map &map, const planner_config &config)
+    : map(map), config(config), stats(own_stats) {}
+
+  // Reports into stats instead, e.g. the totals of all of a server's connections
+  planner_session(const highway_map &map, const planner_config &config, stage_stats &stats)
+    : map(map), config(config), stats(stats) {}
+
+  const highway_map &map;
+  const planner_config &config;
+  planner_state state;
+  stage_stats &stats; // stage latencies and counters of every cycle
+  flight_record record; // summary of the last cycle
+
+private:
+  stage_stats own_stats;
+};
+
+// The reply to one telemetry event
+struct planned_path {
+  path_buffer x;
+  path_buffer y;
+};
+
+// One planning cycle without any transport: telemetry is the data of a
+// "telemetry" event, and path is filled with the points to send back.
+// Allocates from the current arena, see arena.h; path is valid until that
+// arena is reset. Telemetry that does not decode, see
+// decode_telemetry(), is not planned: it counts as a malformed frame and
+// plan() returns false.
+bool plan(const telemetry_json &telemetry, planner_session &session, planned_path &path);
+void plan(const telemetry_frame &telemetry, planner_session &session, planned_path &path);
+
+// Same, as part of a cycle the caller times, e.g. one that goes on to send
+// the reply: the planning stages are lapped on timer, which records into
+// session.stats, and the caller laps its own stages and finishes it
+bool plan(const telemetry_json &telemetry, planner_session &session, planned_path &path,
+          stage_timer &timer);
+void plan(const telemetry_frame &telemetry, planner_session &session, planned_path &path,
+          stage_timer &timer);
+
+#endif // PLANNER_H
@@ -0,0 +1,105 @@
+#include <math.h>
+#include <stdint.h>
+#include "prediction.h"
+
+namespace {
+
+const double PRIOR = 0.05; // weight of a lane change nobody signals
+const double SIGNAL_D_RATE = 1; // m/s of lateral velocity that is a clear lane change
+const double LANE_CHANGE_D_RATE = 1; // m/s, the least lateral velocity of a predicted lane change
+const double SETTLE_TIME = 2; // s a car keeping its lane takes back to the lane center
+
+// Clamps to [0, 1] without comparisons, which keeps the loops below free of
+// control flow the vectorizer gives up on
+inline double clamp01(double x) {
+  return 0.5 * (fabs(x) - fabs(x - 1) + 1);
+}
+
+// Probability of every manoeuvre from how fast and on which side of its lane
+// center a vehicle moves sideways. Lanes off the road get none.
+void probability_kernel(int n, double lanes, double lane_width,
+                        const double *__restrict lane, const double *__restrict d,
+                        const double *__restrict d_rate, double *__restrict keep,
+                        double *__restrict left, double *__restrict right) {
+  for(int i = 0; i < n; i++) {
+    double center = lane_width * (lane[i] + 0.5);
+    // 0 at the left edge of the lane, 1 at the right edge
+    double side = clamp01(0.5 + (d[i] - center) / lane_width);
+    double to_left = clamp01(-d_rate[i] / SIGNAL_D_RATE) * (1 - side);
+    double to_right = clamp01(d_rate[i] / SIGNAL_D_RATE) * side;
+    // lanes are whole numbers, so these are 1 if there is a lane on that side
+    double w_left = (PRIOR + to_left) * clamp01(lane[i]);
+    double w_right = (PRIOR + to_right) * clamp01(lanes - 1 - lane[i]);
+    double w_keep = 1 + PRIOR - clamp01(to_left + to_right);
+    double total = w_keep + w_left + w_right;
+    keep[i] = w_keep / total;
+    left[i] = w_left / total;
+    right[i] = w_right / total;
+  }
+}
+
+// s at time t under constant acceleration, stopping rather than reversing,
+// and d for the three manoeuvres
+void step_kernel(int n, double t, double lane_width,
+                 const double *__restrict s0, const double *__restrict speed,
+                 const double *__restrict accel, const double *__restrict lane,
+                 const double *__restrict d0, const double *__restrict d_rate,
+                 double *__restrict s_keep, double *__restrict s_left, double *__restrict s_right,
+                 double *__restrict d_keep, double *__restrict d_left, double *__restrict d_right) {
+  double settle = clamp01(1 - t / SETTLE_TIME);
+  for(int i = 0; i < n; i++) {
+    // only an acceleration against the speed brings the vehicle to a stop; a
+    // standing vehicle that accelerates drives off
+    double stop_time = speed[i] * accel[i] < 0 ? -speed[i] / accel[i] : t;
+    double te = stop_time < t ? stop_time : t;
+    double s = s0[i] + speed[i] * te + 0.5 * accel[i] * te * te;
+    s_keep[i] = s;
+    s_left[i] = s;
+    s_right[i] = s;
+
+    double center = lane_width * (lane[i] + 0.5);
+    double rate = d_rate[i] < 0 ? -d_rate[i] : d_rate[i];
+    rate = rate > LANE_CHANGE_D_RATE ? rate : LANE_CHANGE_D_RATE;
+    double left_move = center - lane_width - d0[i];
+    double right_move = center + lane_width - d0[i];
+    d_keep[i] = center + (d0[i] - center) * settle;
+    d_left[i] = d0[i] + (left_move > -rate * t ? left_move : -rate * t);
+    d_right[i] = d0[i] + (right_move < rate * t ? right_move : rate * t);
+  }
+}
+
+}
+
+void prediction_tensor::predict(const sensor_fusion_frame &vehicles, double start_time,
+                                const planner_config &config) {
+  step_count = config.prediction_steps + 1;
+  vehicle_count = vehicles.size();
+  stride = vehicles.padded_size();
+  start = start_time;
+  step_s = config.prediction_step_s;
+
+  // probabilities, then s and d of every step and manoeuvre, 32 byte aligned
+  size_t rows = MANOEUVRE_COUNT + 2 * step_count * MANOEUVRE_COUNT;
+  storage.assign(rows * stride + 3, 0.0);
+  uintptr_t p = (uintptr_t)storage.data();
+  probabilities = (double *)((p + 31) & ~(uintptr_t)31);
+  s_values = probabilities + MANOEUVRE_COUNT * stride;
+  d_values = s_values + step_count * MANOEUVRE_COUNT * stride;
+
+  const double *lane = vehicles[sensor_fusion_frame::LANE];
+  const double *d = vehicles[sensor_fusion_frame::D];
+  const double *d_rate = vehicles[sensor_fusion_frame::D_RATE];
+  probability_kernel(stride, config.lanes, config.lane_width, lane, d, d_rate,
+                     probabilities + KEEP_LANE * stride, probabilities + CHANGE_LEFT * stride,
+                     probabilities + CHANGE_RIGHT * stride);
+
+  for(int step = 0; step < step_count; step++) {
+    double *s_row = s_values + step * MANOEUVRE_COUNT * stride;
+    double *d_row = d_values + step * MANOEUVRE_COUNT * stride;
+    step_kernel(stride, step_time(step), config.lane_width,
+                vehicles[sensor_fusion_frame::S], vehicles[sensor_fusion_frame::SPEED],
+                vehicles[sensor_fusion_frame::ACCEL], lane, d, d_rate,
+                s_row + KEEP_LANE * stride, s_row + CHANGE_LEFT * stride, s_row + CHANGE_RIGHT * stride,
+                d_row + KEEP_LANE * stride, d_row + CHANGE_LEFT * stride, d_row + CHANGE_RIGHT * stride);
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include "arena.h"
+#include "planner.h"
+#include "sensor_fusion.h"
+
+// What another vehicle may do next
+enum manoeuvre {KEEP_LANE, CHANGE_LEFT, CHANGE_RIGHT, MANOEUVRE_COUNT};
+
+// Predicted s and d of every vehicle under every manoeuvre at fixed time
+// steps, with the probability of each manoeuvre. One flat tensor indexed by
+// [step][manoeuvre][vehicle]; vehicles are innermost, so a step of one
+// manoeuvre is a contiguous row and every row is computed by one vectorized
+// loop. The work per vehicle does not depend on how many vehicles there are.
+class prediction_tensor {
+public:
+  // Predicts from start_time seconds after the frame on, in
+  // config.prediction_steps steps of config.prediction_step_s; step 0 is
+  // start_time itself. Needs the lanes from vehicles.bin_and_extrapolate()
+  // and the ACCEL and D_RATE columns.
+  void predict(const sensor_fusion_frame &vehicles, double start_time, const planner_config &config);
+
+  int steps() const { return step_count; }
+  int vehicles() const { return vehicle_count; }
+  double step_time(int step) const { return start + step * step_s; }
+
+  const double *probability(manoeuvre m) const { return probabilities + m * stride; }
+  const double *s(int step, manoeuvre m) const { return s_values + (step * MANOEUVRE_COUNT + m) * stride; }
+  const double *d(int step, manoeuvre m) const { return d_values + (step * MANOEUVRE_COUNT + m) * stride; }
+
+private:
+  int step_count = 0;
+  int vehicle_count = 0;
+  int stride = 0;
+  double start = 0;
+  double step_s = 0;
+  double *probabilities = nullptr;
+  double *s_values = nullptr;
+  double *d_values = nullptr;
+  arena_vector<double> storage;
+};
+
+#endif // PREDICTION_H
@@ -0,0 +1,51 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "json.hpp"
+
+// Checks if the SocketIO event has JSON data. If there is, first and last
+// delimit the JSON in place in the received buffer; returns false when there
+// is no data.
+inline bool hasData(const char *data, size_t length, const char *&first, const char *&last) {
+  const char *end = data + length;
+  const char *null_word = "null";
+  if (std::search(data, end, null_word, null_word + 4) != end) {
+    return false;
+  }
+  const char *b1 = std::find(data, end, '[');
+  const char *b2 = std::find(data, end, '}');
+  if (b1 == end || b2 == end) {
+    return false;
+  }
+  first = b1;
+  last = std::min(b2 + 2, end);
+  return true;
+}
+
+// Writes the SocketIO "control" event carrying the path for the simulator.
+// Numbers are printed like json::dump does, without building a json DOM, so
+// out can live in the cycle's arena.
+template <typename String, typename Path>
+void write_control_message(String &out, const Path &next_x_vals, const Path &next_y_vals) {
+  char number[32];
+  out.clear();
+  out.reserve(32 + 48 * (next_x_vals.size() + next_y_vals.size()));
+  out += "42[\"control\",{\"next_x\":[";
+  for(size_t i = 0; i < next_x_vals.size(); i++) {
+    int n = snprintf(number, sizeof(number), i ? ",%.15g" : "%.15g", next_x_vals[i]);
+    out.append(number, n);
+  }
+  out += "],\"next_y\":[";
+  for(size_t i = 0; i < next_y_vals.size(); i++) {
+    int n = snprintf(number, sizeof(number), i ? ",%.15g" : "%.15g", next_y_vals[i]);
+    out.append(number, n);
+  }
+  out += "]}]";
+}
+
+#endif // PROTOCOL_H
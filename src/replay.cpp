@@ -0,0 +1,329 @@
+// Replays recorded telemetry frames through the planner, checks the produced
+// paths against golden outputs and enforces latency and allocation budgets.
+//
+//   replay <corpus> [--map <file>] [--config <file>] [--golden <file>] [--write-golden <file>]
+//                   [--budgets <file>] [--iterations <n>] [--encoding binary]
+//   replay <corpus> --synthesize <frames> [--map <file>] [--lag <steps>] [--start-s <m>]
+//                   [--max-accel <m/s^2>]
+//
+// Every line of a corpus is a raw websocket message as received in onMessage,
+// every line of a golden file the {"next_x", "next_y"} payload of the reply.
+// With --encoding binary the frames are converted to binary_protocol.h
+// messages up front and planned and answered in that encoding instead.
+// --lag makes the replies of a synthesized drive land that many simulator
+// steps late; the corpus does not keep the timing, so it replays as if on time.
+// --start-s moves the synthesized scene along the road so that the drive
+// starts with the ego car at that s, e.g. just before the end of the loop.
+// --max-accel fails the drive when the ego car's velocity changes faster,
+// averaged over 0.2 s as the simulator measures it.
+// Exits with 1 when a path differs or a budget is exceeded, and with 2 when
+// the input cannot be read, including a corpus line that is not telemetry.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "planner.h"
+#include "protocol.h"
+#include "binary_protocol.h"
+#include "arena.h"
+#include "stage_stats.h"
+#include "synthetic_drive.h"
+
+using namespace std;
+
+struct replay_budgets {
+  double tolerance_m = 1e-6; // allowed difference to the golden path points
+  double max_p99_frame_us = 0; // 0 disables the check
+  int64_t max_stage_allocations[STAGE_COUNT]; // -1 disables the check
+
+  replay_budgets() {
+    for(int i = 0; i < STAGE_COUNT; i++) {
+      max_stage_allocations[i] = -1;
+    }
+  }
+};
+
+static bool load_budgets(const string &file, replay_budgets &budgets) {
+  ifstream in(file.c_str());
+  if(!in) {
+    return false;
+  }
+  json j = json::parse(in);
+  if(j.count("tolerance_m")) budgets.tolerance_m = j["tolerance_m"];
+  if(j.count("max_p99_frame_us")) budgets.max_p99_frame_us = j["max_p99_frame_us"];
+  if(j.count("max_frame_allocations")) budgets.max_stage_allocations[STAGE_CYCLE] = j["max_frame_allocations"];
+  // per stage budgets, e.g. {"path_emission": 0}
+  if(j.count("max_stage_allocations")) {
+    for(int i = 0; i < STAGE_COUNT; i++) {
+      if(j["max_stage_allocations"].count(stage_name(i))) {
+        budgets.max_stage_allocations[i] = j["max_stage_allocations"][stage_name(i)];
+      }
+    }
+  }
+  return true;
+}
+
+static bool read_lines(const string &file, vector<string> &lines) {
+  ifstream in(file.c_str());
+  if(!in) {
+    return false;
+  }
+  string line;
+  while(getline(in, line)) {
+    if(!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  return true;
+}
+
+// Closed loop drive with the synthetic simulator, recorded as a corpus
+static int synthesize(const highway_map &map, const planner_config &config, const string &corpus_file,
+                      int frames, int lag_steps, double start_s, double max_accel) {
+  ofstream out(corpus_file.c_str());
+  if(!out) {
+    cerr << "Cannot write " << corpus_file << endl;
+    return 1;
+  }
+  synthetic_drive drive = start_s < 0 ? synthetic_drive(map, config.lanes)
+                                      : synthetic_drive(map, start_s, config.lanes);
+  synthetic_drive::telemetry telemetry;
+  planner_session session(map, config);
+  // the simulator runs a varying number of steps while we plan
+  const int steps[] = {2, 3, 3, 4};
+  for(int i = 0; i < frames; i++) {
+    out << drive.telemetry_message() << "\n";
+
+    drive.current_telemetry(telemetry);
+    planned_path path;
+    plan(drive.frame(telemetry, lag_steps), session, path);
+    drive.advance(vector<double>(path.x.begin(), path.x.end()),
+                  vector<double>(path.y.begin(), path.y.end()), lag_steps + steps[i % 4], lag_steps);
+  }
+  cout << "Wrote " << frames << " frames to " << corpus_file << ", largest ego acceleration "
+       << drive.max_acceleration() << " m/s^2 over " << synthetic_drive::ACCEL_WINDOW * 0.02 << " s, "
+       << drive.max_step_acceleration() << " m/s^2 from one step to the next" << endl;
+  if(max_accel > 0 && drive.max_acceleration() > max_accel) {
+    cerr << "Ego acceleration is over the limit of " << max_accel << " m/s^2" << endl;
+    return 1;
+  }
+  return 0;
+}
+
+static bool compare_paths(const json &golden, const json &produced, double tolerance, size_t frame) {
+  for(const char *key : {"next_x", "next_y"}) {
+    const json &a = golden[key];
+    const json &b = produced[key];
+    if(a.size() != b.size()) {
+      cerr << "frame " << frame << ": " << key << " has " << b.size()
+           << " points, golden has " << a.size() << endl;
+      return false;
+    }
+    for(size_t i = 0; i < a.size(); i++) {
+      double diff = fabs(a[i].get<double>() - b[i].get<double>());
+      if(diff > tolerance) {
+        cerr << "frame " << frame << ": " << key << "[" << i << "] differs by "
+             << diff << " m" << endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    cerr << "Usage: " << argv[0] << " <corpus> [--map <file>] [--config <file>] [--golden <file>] "
+         << "[--write-golden <file>] [--budgets <file>] [--iterations <n>] "
+         << "[--encoding binary] [--synthesize <frames>] [--lag <steps>] [--start-s <m>] "
+         << "[--max-accel <m/s^2>]" << endl;
+    return 2;
+  }
+
+  string corpus_file = argv[1];
+  string map_file = "../data/highway_map.csv";
+  string config_file = "../data/planner_config.json";
+  string golden_file, write_golden_file, budgets_file;
+  int iterations = 1;
+  int synthesize_frames = 0;
+  int lag_steps = 0;
+  double start_s = -1; // where the simulator spawns the car
+  double max_accel = 0; // 0 disables the check
+  bool binary = false;
+  for(int i = 2; i + 1 < argc; i += 2) {
+    string option = argv[i];
+    string value = argv[i + 1];
+    if(option == "--map") map_file = value;
+    else if(option == "--config") config_file = value;
+    else if(option == "--golden") golden_file = value;
+    else if(option == "--write-golden") write_golden_file = value;
+    else if(option == "--budgets") budgets_file = value;
+    else if(option == "--iterations") iterations = atoi(value.c_str());
+    else if(option == "--synthesize") synthesize_frames = atoi(value.c_str());
+    else if(option == "--lag") lag_steps = atoi(value.c_str());
+    else if(option == "--start-s") start_s = atof(value.c_str());
+    else if(option == "--max-accel") max_accel = atof(value.c_str());
+    else if(option == "--encoding" && (value == "json" || value == "binary")) binary = value == "binary";
+    else {
+      cerr << "Unknown option " << option << endl;
+      return 2;
+    }
+  }
+
+  highway_map map;
+  if(!load_map(map_file, map)) {
+    cerr << "Cannot read map " << map_file << endl;
+    return 2;
+  }
+  planner_config config;
+  if(!load_config(config_file, config)) {
+    cerr << "Cannot read config " << config_file << endl;
+    return 2;
+  }
+  if(synthesize_frames > 0) {
+    return synthesize(map, config, corpus_file, synthesize_frames, lag_steps, start_s, max_accel);
+  }
+
+  replay_budgets budgets;
+  if(!budgets_file.empty() && !load_budgets(budgets_file, budgets)) {
+    cerr << "Cannot read budgets " << budgets_file << endl;
+    return 2;
+  }
+
+  vector<string> frames, golden;
+  if(!read_lines(corpus_file, frames)) {
+    cerr << "Cannot read corpus " << corpus_file << endl;
+    return 2;
+  }
+  // a line that is not telemetry would shift every frame after it against
+  // the golden output, so the corpus is rejected rather than the line skipped
+  for(size_t i = 0; i < frames.size(); i++) {
+    const char *first, *last;
+    bool telemetry = hasData(frames[i].data(), frames[i].size(), first, last);
+    if(telemetry) {
+      try {
+        telemetry_json j = telemetry_json::parse(first, last);
+        path_buffer storage;
+        telemetry_frame frame;
+        telemetry = j.is_array() && j.size() > 1 && j[0] == "telemetry" && j[1].is_object() &&
+                    decode_telemetry(j[1], storage, frame);
+      } catch(const std::exception &) {
+        telemetry = false;
+      }
+    }
+    if(!telemetry) {
+      cerr << "Line " << i + 1 << " of " << corpus_file << " is not a telemetry message" << endl;
+      return 2;
+    }
+  }
+  if(!golden_file.empty() && !read_lines(golden_file, golden)) {
+    cerr << "Cannot read golden output " << golden_file << endl;
+    return 2;
+  }
+  if(!golden.empty() && golden.size() != frames.size()) {
+    cerr << "Golden output has " << golden.size() << " frames, corpus has "
+         << frames.size() << endl;
+    return 1;
+  }
+
+  if(binary) {
+    for(string &frame : frames) {
+      const char *first, *last;
+      hasData(frame.data(), frame.size(), first, last);
+      telemetry_json j = telemetry_json::parse(first, last);
+      path_buffer storage;
+      telemetry_frame telemetry;
+      decode_telemetry(j[1], storage, telemetry);
+      write_telemetry_message(frame, telemetry);
+    }
+  }
+
+  ofstream golden_out;
+  if(!write_golden_file.empty()) {
+    golden_out.open(write_golden_file.c_str());
+  }
+
+  stage_stats stats;
+  size_t arena_peak = 0;
+  bool passed = true;
+
+  for(int iteration = 0; iteration < iterations; iteration++) {
+    planner_session session(map, config, stats);
+    monotonic_arena arena;
+    for(size_t i = 0; i < frames.size(); i++) {
+      stage_timer timer(stats);
+      arena_scope scope(arena);
+
+      planned_path path;
+      arena_string msg;
+      path_buffer storage;
+      telemetry_frame telemetry;
+      if(binary) {
+        read_telemetry_message(frames[i].data(), frames[i].size(), storage, telemetry);
+      } else {
+        const char *first, *last;
+        hasData(frames[i].data(), frames[i].size(), first, last);
+        telemetry_json j = telemetry_json::parse(first, last);
+        decode_telemetry(j[1], storage, telemetry);
+      }
+      // every frame arrives just as the reply to the last one lands and is
+      // planned in no time, so the paths do not depend on the machine's load
+      telemetry.received_ns = 1;
+      telemetry.planning_ns = 0;
+      // the server's cycle, less sending the reply
+      plan(telemetry, session, path, timer);
+      if(binary) {
+        write_control_binary(msg, path.x, path.y);
+      } else {
+        write_control_message(msg, path.x, path.y);
+      }
+      timer.lap(STAGE_SERIALIZATION);
+      timer.finish();
+      arena_peak = max(arena_peak, arena.peak_used());
+
+      if(iteration > 0) {
+        continue;
+      }
+      if(binary) {
+        // compared as the JSON the reply decodes to
+        vector<double> x, y;
+        read_control_message(msg.data(), msg.length(), x, y);
+        write_control_message(msg, x, y);
+      }
+      // the payload of the "control" event, without the SocketIO framing
+      string payload(msg.data() + 13, msg.length() - 14);
+      if(golden_out.is_open()) {
+        golden_out << payload << "\n";
+      }
+      if(!golden.empty() && passed &&
+         !compare_paths(json::parse(golden[i]), json::parse(payload), budgets.tolerance_m, i)) {
+        passed = false;
+      }
+    }
+  }
+
+  json report = stats.to_json();
+  report["frames"] = frames.size() * iterations;
+  report["arena_peak_bytes"] = arena_peak;
+  cout << report.dump(2) << endl;
+
+  double p99_us = stats.stages[STAGE_CYCLE].percentile(99) / 1000.0;
+  if(budgets.max_p99_frame_us > 0 && p99_us > budgets.max_p99_frame_us) {
+    cerr << "p99 frame latency " << p99_us << " us is over the budget of "
+         << budgets.max_p99_frame_us << " us" << endl;
+    passed = false;
+  }
+  for(int i = 0; i < STAGE_COUNT; i++) {
+    int64_t budget = budgets.max_stage_allocations[i];
+    if(budget >= 0 && stats.max_allocations[i] > (uint64_t)budget) {
+      cerr << stats.max_allocations[i] << " allocations in " << stage_name(i)
+           << " are over the budget of " << budget << endl;
+      passed = false;
+    }
+  }
+
+  cout << (passed ? "PASSED" : "FAILED") << endl;
+  return passed ? 0 : 1;
+}
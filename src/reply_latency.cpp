@@ -0,0 +1,31 @@
+#include <algorithm>
+#include "reply_latency.h"
+
+using namespace std;
+
+namespace {
+
+const int64_t STEP_NS = 20000000; // one simulator step
+
+}
+
+void reply_latency::frame_received(int64_t received_ns, int consumed) {
+  if(sent >= 0) {
+    // a simulator that waits before sending the next frame shows up as a
+    // negative delay, which is no delay at all
+    double delay = max((double)(received_ns - sent - consumed * STEP_NS), 0.0);
+    transport = measured ? transport + SMOOTHING * (delay - transport) : delay;
+    measured = true;
+  }
+  received = received_ns;
+}
+
+void reply_latency::reply_sent(int64_t sent_ns) {
+  sent = sent_ns;
+  planning = max(sent_ns - received, (int64_t)0);
+}
+
+int reply_latency::lead_points() const {
+  // rounded, so a replay plans the same paths however fast the machine is
+  return (int)((transport + planning) / STEP_NS + 0.5);
+}
@@ -0,0 +1,38 @@
+#ifndef REPLY_LATENCY_H
+#define REPLY_LATENCY_H
+
+#include <stdint.h>
+
+// Estimates how many points the simulator drives between sampling a
+// telemetry frame and switching to the path we plan from it. The simulator
+// keeps driving its old path until our reply lands and then starts from the
+// first point of the new one, so that many points are left out of the reply.
+//
+// The delay has two parts: our own planning time, from the arrival of a
+// frame to the reply, and the time the messages spend on the way both
+// directions. The latter is what is left of the time from a reply to the
+// next frame once the simulation time the simulator drove on our path is
+// taken off; it is smoothed over cycles, as a single frame may be late.
+class reply_latency {
+public:
+  // Takes the arrival time of a frame and the points of our last reply the
+  // simulator drove since it switched to it
+  void frame_received(int64_t received_ns, int consumed);
+
+  // Time the reply planned from the frame was sent
+  void reply_sent(int64_t sent_ns);
+
+  // Points driven from sampling a frame to switching to our reply
+  int lead_points() const;
+
+  static constexpr double SMOOTHING = 0.2; // weight of the latest cycle
+
+private:
+  int64_t received = 0;
+  int64_t sent = -1; // of the last reply, -1 before the first one
+  double transport = 0; // both ways, smoothed
+  bool measured = false; // whether transport has been measured yet
+  int64_t planning = 0; // of the last cycle
+};
+
+#endif // REPLY_LATENCY_H
@@ -0,0 +1,55 @@
+#include <math.h>
+#include <stdint.h>
+#include "sensor_fusion.h"
+
+void sensor_fusion_frame::resize(int vehicles) {
+  count = vehicles;
+  stride = (vehicles + 3) & ~3;
+  // 3 doubles of slack to move the first column to a 32 byte boundary
+  storage.assign(COLUMN_COUNT * stride + 3, 0.0);
+  uintptr_t p = (uintptr_t)storage.data();
+  base = (double *)((p + 31) & ~(uintptr_t)31);
+}
+
+void sensor_fusion_frame::ingest(const double *rows, int vehicles) {
+  resize(vehicles);
+  for(int k = 0; k < telemetry_frame::SENSOR_FUSION_FIELDS; k++) {
+    double *column = base + k * stride;
+    for(int i = 0; i < vehicles; i++) {
+      column[i] = rows[i * telemetry_frame::SENSOR_FUSION_FIELDS + k];
+    }
+  }
+}
+
+// Kept free functions with restrict parameters, the columns never overlap.
+// No branches, so these run over whole vectors including the padding.
+static void speed_kernel(int n, const double *__restrict vx, const double *__restrict vy,
+                         double *__restrict speed) {
+  for(int i = 0; i < n; i++) {
+    speed[i] = sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+  }
+}
+
+static void bin_and_extrapolate_kernel(int n, double horizon, double lanes, double lane_width,
+                                       const double *__restrict s, const double *__restrict d,
+                                       const double *__restrict speed, double *__restrict predicted_s,
+                                       double *__restrict lane) {
+  for(int i = 0; i < n; i++) {
+    predicted_s[i] = s[i] + horizon * speed[i];
+    // clamped first, so truncation is floor and the cast cannot overflow
+    double l = d[i] / lane_width;
+    l = l < 0 ? 0 : l;
+    l = l < lanes - 1 ? l : lanes - 1;
+    lane[i] = (double)(int)l;
+  }
+}
+
+void sensor_fusion_frame::measure_speed() {
+  speed_kernel(stride, (*this)[VX], (*this)[VY], (*this)[SPEED]);
+}
+
+void sensor_fusion_frame::bin_and_extrapolate(double horizon, const planner_config &config) {
+  bin_and_extrapolate_kernel(stride, horizon, config.lanes, config.lane_width,
+                             (*this)[S], (*this)[D], (*this)[SPEED],
+                             (*this)[PREDICTED_S], (*this)[LANE]);
+}
@@ -0,0 +1,42 @@
+#ifndef SENSOR_FUSION_H
+#define SENSOR_FUSION_H
+
+#include "arena.h"
+#include "planner.h"
+
+// Sensor fusion of one frame as struct-of-arrays. The columns are 32 byte
+// aligned and padded to a multiple of four vehicles, so the per-vehicle passes
+// below run as plain loops the compiler vectorizes.
+class sensor_fusion_frame {
+public:
+  enum column {ID, X, Y, VX, VY, S, D, SPEED, PREDICTED_S, LANE,
+               ACCEL, D_RATE, // from the vehicle's track, filled by the planner
+               COLUMN_COUNT};
+
+  // Copies the [id, x, y, vx, vy, s, d] rows of a telemetry frame
+  void ingest(const double *rows, int vehicles);
+
+  // Speed of every vehicle from its velocity
+  void measure_speed();
+
+  // s after horizon seconds at constant speed and lane of every vehicle in
+  // one pass, from the S, D and SPEED columns
+  void bin_and_extrapolate(double horizon, const planner_config &config);
+
+  int size() const { return count; }
+  int padded_size() const { return stride; }
+
+  // The lane column is stored as double to keep the pass in one register width
+  const double *operator[](column c) const { return base + c * stride; }
+  double *operator[](column c) { return base + c * stride; }
+
+private:
+  void resize(int vehicles);
+
+  int count = 0;
+  int stride = 0; // doubles per column
+  double *base = nullptr;
+  arena_vector<double> storage;
+};
+
+#endif // SENSOR_FUSION_H
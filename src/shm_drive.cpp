@@ -0,0 +1,204 @@
+// Stand-in for a simulator on the same host: drives the synthetic simulator
+// of the replay tool against a planner started with --shm <name> and reports
+// the round-trip latency of the shared memory transport.
+//
+//   shm_drive <name> [--frames <n>] [--map <file>] [--record <corpus>] [--serve <config>]
+//
+// --record writes the telemetry it sent as a replay corpus, which matches the
+// one replay --synthesize writes for the same number of frames.
+// --serve runs the planner's side of the segment on a thread of this process
+// instead, with the given config, and at the end also checks that it refuses
+// a record over the limits of shm_transport.h.
+// Exits with 1 when a frame is not answered, or cannot be sent in a record.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "arena.h"
+#include "planner.h"
+#include "shm_transport.h"
+#include "stage_stats.h"
+#include "synthetic_drive.h"
+
+using namespace std;
+
+const int TIMEOUT_MS = 1000; // a planner slower than this is gone
+
+// Sends a record with one point more than it holds, which the planner must
+// refuse
+static bool check_refused(shm_channel &channel, uint64_t sequence) {
+  shm_telemetry_record *out = channel.begin_telemetry(TIMEOUT_MS);
+  if(!out) {
+    return false;
+  }
+  memset(out, 0, sizeof(*out));
+  out->sequence = sequence;
+  out->previous_size = SHM_MAX_POINTS + 1;
+  channel.send_telemetry();
+  const shm_control_record *in = channel.receive_control(TIMEOUT_MS);
+  bool refused = in && in->sequence == sequence && in->size == -1;
+  if(in) {
+    channel.release_control();
+  }
+  return refused;
+}
+
+int main(int argc, char **argv) {
+  if(argc < 2) {
+    cerr << "Usage: " << argv[0] << " <name> [--frames <n>] [--map <file>] [--record <corpus>] "
+         << "[--serve <config>]" << endl;
+    return 2;
+  }
+
+  string name = argv[1];
+  string map_file = "../data/highway_map.csv";
+  string record_file;
+  string serve_config;
+  int frames = 1500;
+  for(int i = 2; i + 1 < argc; i += 2) {
+    string option = argv[i];
+    string value = argv[i + 1];
+    if(option == "--frames") frames = atoi(value.c_str());
+    else if(option == "--map") map_file = value;
+    else if(option == "--record") record_file = value;
+    else if(option == "--serve") serve_config = value;
+    else {
+      cerr << "Unknown option " << option << endl;
+      return 2;
+    }
+  }
+
+  highway_map map;
+  if(!load_map(map_file, map)) {
+    cerr << "Cannot read map " << map_file << endl;
+    return 2;
+  }
+  ofstream corpus;
+  if(!record_file.empty()) {
+    corpus.open(record_file.c_str());
+  }
+
+  // the planner's side, when it runs here
+  planner_config config;
+  shm_channel server_channel;
+  stage_stats server_stats;
+  thread server;
+  if(!serve_config.empty()) {
+    if(!load_config(serve_config, config)) {
+      cerr << "Cannot read config " << serve_config << endl;
+      return 2;
+    }
+    if(!server_channel.create(name)) {
+      cerr << "Cannot create shared memory segment " << name << endl;
+      return 1;
+    }
+    server = thread([&]() {
+      planner_session session(map, config, server_stats);
+      monotonic_arena arena;
+      serve_shm(server_channel, session, arena);
+    });
+  }
+
+  // the planner may still be starting
+  shm_channel channel;
+  for(int attempt = 0; !channel.open(name); attempt++) {
+    if(attempt == 50) {
+      cerr << "Cannot open shared memory segment " << name << endl;
+      if(server.joinable()) {
+        server_channel.close();
+        server.join();
+      }
+      return 1;
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+  }
+
+  synthetic_drive drive(map);
+  synthetic_drive::telemetry telemetry;
+  latency_histogram round_trip;
+  vector<double> next_x, next_y;
+  // the simulator runs a varying number of steps while we plan
+  const int steps[] = {2, 3, 3, 4};
+  int result = 0;
+  for(int i = 0; i < frames; i++) {
+    if(corpus.is_open()) {
+      corpus << drive.telemetry_message() << "\n";
+    }
+    drive.current_telemetry(telemetry);
+    int vehicles = telemetry.sensor_fusion.size() / telemetry_frame::SENSOR_FUSION_FIELDS;
+    if((int)telemetry.previous_x.size() > SHM_MAX_POINTS || vehicles > SHM_MAX_VEHICLES) {
+      cerr << "Frame " << i << " has " << telemetry.previous_x.size() << " points and " << vehicles
+           << " cars, a record holds " << SHM_MAX_POINTS << " and " << SHM_MAX_VEHICLES << endl;
+      result = 1;
+      break;
+    }
+
+    auto start = chrono::steady_clock::now();
+    shm_telemetry_record *out = channel.begin_telemetry(TIMEOUT_MS);
+    if(!out) {
+      cerr << "Planner stopped receiving at frame " << i << endl;
+      result = 1;
+      break;
+    }
+    out->sequence = i;
+    out->x = telemetry.x;
+    out->y = telemetry.y;
+    out->s = telemetry.s;
+    out->d = telemetry.d;
+    out->yaw = telemetry.yaw;
+    out->speed = telemetry.speed;
+    out->end_path_s = telemetry.end_path_s;
+    out->end_path_d = telemetry.end_path_d;
+    out->previous_size = telemetry.previous_x.size();
+    copy(telemetry.previous_x.begin(), telemetry.previous_x.end(), out->previous_x);
+    copy(telemetry.previous_y.begin(), telemetry.previous_y.end(), out->previous_y);
+    out->vehicles = vehicles;
+    copy(telemetry.sensor_fusion.begin(), telemetry.sensor_fusion.end(), out->sensor_fusion);
+    channel.send_telemetry();
+
+    const shm_control_record *in = channel.receive_control(TIMEOUT_MS);
+    if(!in || in->sequence != (uint64_t)i) {
+      cerr << "No reply to frame " << i << endl;
+      result = 1;
+      break;
+    }
+    if(in->size < 0) {
+      cerr << "Planner refused frame " << i << endl;
+      channel.release_control();
+      result = 1;
+      break;
+    }
+    next_x.assign(in->x, in->x + in->size);
+    next_y.assign(in->y, in->y + in->size);
+    channel.release_control();
+    int64_t round_trip_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    round_trip.record(round_trip_ns);
+
+    // the planner leaves out the points driven until its reply lands, so the
+    // car drives them on the old path first
+    int late_steps = (int)llround(round_trip_ns / 2e7);
+    drive.advance(next_x, next_y, late_steps + steps[i % 4], late_steps);
+  }
+  if(server.joinable() && result == 0 && !check_refused(channel, frames)) {
+    cerr << "Planner did not refuse a record over the limits" << endl;
+    result = 1;
+  }
+  channel.close();
+  if(server.joinable()) {
+    server.join();
+    if(result == 0 && server_stats.malformed_frames != 1) {
+      cerr << server_stats.malformed_frames << " malformed frames counted, 1 sent" << endl;
+      result = 1;
+    }
+  }
+
+  cout << "frames: " << round_trip.count() << ", round trip p50: " << round_trip.percentile(50) / 1000.0
+       << " us, p99: " << round_trip.percentile(99) / 1000.0 << " us" << endl;
+  return result;
+}
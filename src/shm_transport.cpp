@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_transport.h"
+
+namespace {
+
+const uint32_t MAGIC = 0x50505348; // "PPSH"
+const uint32_t VERSION = 1;
+const int SPINS = 4000; // checks before going to sleep, a few microseconds
+const int POLL_MS = 100; // how often a waiting planner checks whether the simulator left
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+// Sleeps while word holds value, at most timeout_ms. Not the private futex
+// operations, as the two sides are different processes.
+void futex_wait(std::atomic<uint32_t> &word, uint32_t value, int64_t timeout_ns) {
+  timespec timeout;
+  timeout.tv_sec = timeout_ns / 1000000000;
+  timeout.tv_nsec = timeout_ns % 1000000000;
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t> &word, std::atomic<uint32_t> &sleepers) {
+  if(sleepers.load()) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+  }
+}
+
+// Waits until word no longer holds value; false if it still does after
+// timeout_ms. The sleeper count goes up before the futex checks the word
+// again, so a wake after the change is never missed.
+bool wait_change(std::atomic<uint32_t> &word, uint32_t value, std::atomic<uint32_t> &sleepers,
+                 int timeout_ms) {
+  for(int i = 0; i < SPINS; i++) {
+    if(word.load(std::memory_order_acquire) != value) {
+      return true;
+    }
+    cpu_relax();
+  }
+  typedef std::chrono::steady_clock clock;
+  clock::time_point deadline = clock::now() + std::chrono::milliseconds(timeout_ms);
+  while(word.load(std::memory_order_acquire) == value) {
+    int64_t remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - clock::now()).count();
+    if(remaining <= 0) {
+      return false;
+    }
+    sleepers.fetch_add(1);
+    futex_wait(word, value, remaining);
+    sleepers.fetch_sub(1);
+  }
+  return true;
+}
+
+// Next record to receive from ring, or null if none came in time
+template <typename record>
+record *receive(shm_ring<record> &ring, int timeout_ms) {
+  uint32_t tail = ring.tail.load(std::memory_order_relaxed);
+  if(ring.head.load(std::memory_order_acquire) == tail &&
+     !wait_change(ring.head, tail, ring.head_sleepers, timeout_ms)) {
+    return nullptr;
+  }
+  return &ring.slots[tail & (SHM_SLOTS - 1)];
+}
+
+template <typename record>
+void release(shm_ring<record> &ring) {
+  ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+  futex_wake(ring.tail, ring.tail_sleepers);
+}
+
+// Slot for the next record to send on ring, or null if none freed up in time
+template <typename record>
+record *begin(shm_ring<record> &ring, int timeout_ms) {
+  uint32_t head = ring.head.load(std::memory_order_relaxed);
+  uint32_t tail = ring.tail.load(std::memory_order_acquire);
+  while(head - tail >= (uint32_t)SHM_SLOTS) {
+    if(!wait_change(ring.tail, tail, ring.tail_sleepers, timeout_ms)) {
+      return nullptr;
+    }
+    tail = ring.tail.load(std::memory_order_acquire);
+  }
+  return &ring.slots[head & (SHM_SLOTS - 1)];
+}
+
+template <typename record>
+void send(shm_ring<record> &ring) {
+  ring.head.store(ring.head.load(std::memory_order_relaxed) + 1, std::memory_order_seq_cst);
+  futex_wake(ring.head, ring.head_sleepers);
+}
+
+shm_segment *map_segment(int fd) {
+  void *memory = mmap(nullptr, sizeof(shm_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  return memory == MAP_FAILED ? nullptr : static_cast<shm_segment *>(memory);
+}
+
+}
+
+bool shm_frame(const shm_telemetry_record &record, telemetry_frame &frame) {
+  if(record.previous_size < 0 || record.previous_size > SHM_MAX_POINTS ||
+     record.vehicles < 0 || record.vehicles > SHM_MAX_VEHICLES) {
+    return false;
+  }
+  frame.x = record.x;
+  frame.y = record.y;
+  frame.s = record.s;
+  frame.d = record.d;
+  frame.yaw = record.yaw;
+  frame.speed = record.speed;
+  frame.end_path_s = record.end_path_s;
+  frame.end_path_d = record.end_path_d;
+  frame.previous_x = record.previous_x;
+  frame.previous_y = record.previous_y;
+  frame.previous_size = record.previous_size;
+  frame.sensor_fusion = record.sensor_fusion;
+  frame.vehicles = record.vehicles;
+  return true;
+}
+
+void serve_shm(shm_channel &channel, planner_session &session, monotonic_arena &arena,
+               const shm_cycle_hook &on_cycle) {
+  while(!channel.closed()) {
+    const shm_telemetry_record *telemetry = channel.receive_telemetry(POLL_MS);
+    if(!telemetry) {
+      continue;
+    }
+    stage_timer timer(session.stats);
+    arena_scope scope(arena);
+
+    telemetry_frame frame;
+    planned_path path;
+    bool planned = shm_frame(*telemetry, frame);
+    if(planned) {
+      plan(frame, session, path, timer);
+    } else {
+      session.stats.malformed_frames++;
+    }
+    uint64_t sequence = telemetry->sequence;
+    channel.release_telemetry();
+
+    shm_control_record *control = nullptr;
+    while(!control && !channel.closed()) {
+      control = channel.begin_control(POLL_MS);
+    }
+    if(!control) {
+      break;
+    }
+    int n = std::min((int)path.x.size(), SHM_MAX_POINTS);
+    control->sequence = sequence;
+    control->size = planned ? n : -1;
+    std::copy(path.x.begin(), path.x.begin() + n, control->x);
+    std::copy(path.y.begin(), path.y.begin() + n, control->y);
+    timer.lap(STAGE_SERIALIZATION);
+    channel.send_control();
+    timer.lap(STAGE_SEND);
+    timer.finish();
+    if(planned && on_cycle) {
+      on_cycle(session.record, timer);
+    }
+  }
+}
+
+shm_channel::~shm_channel() {
+  if(segment) {
+    munmap(segment, sizeof(shm_segment));
+  }
+  if(!created.empty()) {
+    shm_unlink(created.c_str());
+  }
+}
+
+bool shm_channel::create(const std::string &name) {
+  std::string path = "/" + name;
+  shm_unlink(path.c_str());
+  int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0) {
+    return false;
+  }
+  if(ftruncate(fd, sizeof(shm_segment)) != 0) {
+    ::close(fd);
+    shm_unlink(path.c_str());
+    return false;
+  }
+  segment = map_segment(fd);
+  if(!segment) {
+    shm_unlink(path.c_str());
+    return false;
+  }
+  // a fresh mapping is zero filled, which is the empty state of the rings
+  created = path;
+  segment->version = VERSION;
+  std::atomic_thread_fence(std::memory_order_release);
+  segment->magic = MAGIC;
+  return true;
+}
+
+bool shm_channel::open(const std::string &name) {
+  int fd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+  if(fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if(fstat(fd, &info) != 0 || info.st_size != (off_t)sizeof(shm_segment)) {
+    ::close(fd);
+    return false;
+  }
+  segment = map_segment(fd);
+  if(!segment) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(segment->magic != MAGIC || segment->version != VERSION) {
+    munmap(segment, sizeof(shm_segment));
+    segment = nullptr;
+    return false;
+  }
+  return true;
+}
+
+bool shm_channel::closed() const {
+  return segment->closed.load() != 0;
+}
+
+void shm_channel::close() {
+  segment->closed.store(1);
+  // wake a planner asleep waiting for telemetry, so it notices
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&segment->telemetry.head), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+
+shm_telemetry_record *shm_channel::begin_telemetry(int timeout_ms) {
+  return begin(segment->telemetry, timeout_ms);
+}
+
+void shm_channel::send_telemetry() {
+  send(segment->telemetry);
+}
+
+const shm_control_record *shm_channel::receive_control(int timeout_ms) {
+  return receive(segment->control, timeout_ms);
+}
+
+void shm_channel::release_control() {
+  release(segment->control);
+}
+
+const shm_telemetry_record *shm_channel::receive_telemetry(int timeout_ms) {
+  return receive(segment->telemetry, timeout_ms);
+}
+
+void shm_channel::release_telemetry() {
+  release(segment->telemetry);
+}
+
+shm_control_record *shm_channel::begin_control(int timeout_ms) {
+  return begin(segment->control, timeout_ms);
+}
+
+void shm_channel::send_control() {
+  send(segment->control);
+}
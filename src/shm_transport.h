@@ -0,0 +1,116 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include "planner.h"
+
+// Transport for a simulator on the same host: a POSIX shared memory segment
+// with one ring of fixed-layout telemetry records towards the planner and one
+// of control records back, instead of JSON over a websocket. Each ring has a
+// single producer and a single consumer; a side that has nothing to do spins
+// briefly and then sleeps on a futex on the ring's counters. Linux only.
+
+const int SHM_MAX_POINTS = 256; // of a path, as many as the planner keeps
+const int SHM_MAX_VEHICLES = 64;
+const int SHM_SLOTS = 4; // records per ring, a power of two
+
+// A "telemetry" event; the arrays are valid up to previous_size and vehicles
+struct shm_telemetry_record {
+  uint64_t sequence; // set by the sender, echoed in the control record
+  double x, y, s, d;
+  double yaw; // degrees
+  double speed; // MPH
+  double end_path_s, end_path_d;
+  int32_t previous_size;
+  int32_t vehicles;
+  double previous_x[SHM_MAX_POINTS];
+  double previous_y[SHM_MAX_POINTS];
+  double sensor_fusion[SHM_MAX_VEHICLES * telemetry_frame::SENSOR_FUSION_FIELDS]; // [id, x, y, vx, vy, s, d] rows
+};
+
+// A "control" event, the path for the simulator
+struct shm_control_record {
+  uint64_t sequence; // of the telemetry record it answers
+  int32_t size; // -1 if the telemetry record was refused, see shm_frame()
+  int32_t reserved;
+  double x[SHM_MAX_POINTS];
+  double y[SHM_MAX_POINTS];
+};
+
+// The planner's view of a telemetry record, without copying it. Returns
+// false if its counts are negative or over SHM_MAX_POINTS or
+// SHM_MAX_VEHICLES, as the arrays cannot hold them.
+bool shm_frame(const shm_telemetry_record &record, telemetry_frame &frame);
+
+template <typename record>
+struct shm_ring {
+  // the producer's and the consumer's counters, each on its own cache line
+  // with the number of threads asleep waiting for it to change, so a side
+  // only makes the wake system call when someone is asleep
+  alignas(64) std::atomic<uint32_t> head; // records sent
+  std::atomic<uint32_t> head_sleepers;
+  alignas(64) std::atomic<uint32_t> tail; // records received
+  std::atomic<uint32_t> tail_sleepers;
+  alignas(64) record slots[SHM_SLOTS];
+};
+
+// Layout of the segment
+struct shm_segment {
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint32_t> closed; // set by the simulator side when it leaves
+  shm_ring<shm_telemetry_record> telemetry;
+  shm_ring<shm_control_record> control;
+};
+
+// One end of a segment. The planner creates it and the simulator opens it.
+// The receive and begin calls wait up to timeout_ms and return null when
+// nothing came, or no slot freed up, in time; every record they return
+// must be handed back with the matching release or send before the next.
+class shm_channel {
+public:
+  shm_channel() = default;
+  shm_channel(const shm_channel &) = delete;
+  shm_channel &operator=(const shm_channel &) = delete;
+  ~shm_channel();
+
+  // Creates /dev/shm/<name>, replacing a stale segment of that name
+  bool create(const std::string &name);
+  bool open(const std::string &name);
+
+  // Whether the simulator side closed the segment
+  bool closed() const;
+  void close();
+
+  // Simulator side
+  shm_telemetry_record *begin_telemetry(int timeout_ms);
+  void send_telemetry();
+  const shm_control_record *receive_control(int timeout_ms);
+  void release_control();
+
+  // Planner side
+  const shm_telemetry_record *receive_telemetry(int timeout_ms);
+  void release_telemetry();
+  shm_control_record *begin_control(int timeout_ms);
+  void send_control();
+
+private:
+  shm_segment *segment = nullptr;
+  std::string created; // name to unlink, if this end created the segment
+};
+
+// Called when the reply of a planned cycle has been sent, with the session's
+// summary of the cycle and its finished timer
+typedef std::function<void(flight_record &record, const stage_timer &timer)> shm_cycle_hook;
+
+// Serves the simulator at the other end of channel until it closes it: each
+// telemetry record is planned through session, in arena, and answered. A
+// record shm_frame() refuses is answered with size -1 and counts as
+// malformed.
+void serve_shm(shm_channel &channel, planner_session &session, monotonic_arena &arena,
+               const shm_cycle_hook &on_cycle = nullptr);
+
+#endif // SHM_TRANSPORT_H
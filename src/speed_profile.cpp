@@ -0,0 +1,100 @@
+#include <math.h>
+#include <algorithm>
+#include "speed_profile.h"
+
+using namespace std;
+
+namespace {
+
+const double ACCEL_STEP = 0.005; // s, half the interval the acceleration is measured over
+
+// Speed gained t seconds into an S-curve of dv >= 0 taking duration seconds
+double s_curve(double dv, double duration, double accel, double jerk, double t) {
+  // time to reach the top acceleration, which a small change never does
+  double ramp = min(accel / jerk, duration / 2);
+  double top = ramp * jerk;
+  if(t < ramp) {
+    return jerk * t * t / 2;
+  }
+  if(t < duration - ramp) {
+    return top * ramp / 2 + top * (t - ramp);
+  }
+  double left = duration - t;
+  return dv - jerk * left * left / 2;
+}
+
+}
+
+s_curve_table::s_curve_table(double max_accel, double max_jerk, double max_change, double resolution)
+    : accel(max_accel), jerk(max_jerk), resolution(resolution) {
+  rows = (int)ceil(max_change / resolution) + 2;
+  durations.assign(rows, 0.0);
+  fractions.assign(rows * (SAMPLES + 1), 1.0);
+  for(int r = 1; r < rows; r++) {
+    double dv = r * resolution;
+    double duration;
+    if(dv >= accel * accel / jerk) {
+      duration = dv / accel + accel / jerk;
+    } else {
+      duration = 2 * sqrt(dv / jerk);
+    }
+    durations[r] = duration;
+    for(int k = 0; k <= SAMPLES; k++) {
+      double t = duration * k / SAMPLES;
+      fractions[r * (SAMPLES + 1) + k] = s_curve(dv, duration, accel, jerk, t) / dv;
+    }
+  }
+  // changes too small to reach the top acceleration all have the same shape
+  copy(fractions.begin() + SAMPLES + 1, fractions.begin() + 2 * (SAMPLES + 1), fractions.begin());
+}
+
+double s_curve_table::duration(double dv) const {
+  double x = min(fabs(dv) / resolution, (double)(rows - 1));
+  int r = min((int)x, rows - 2);
+  double f = x - r;
+  return durations[r] + f * (durations[r + 1] - durations[r]);
+}
+
+double s_curve_table::at(double dv, double t) const {
+  double size = fabs(dv);
+  double x = min(size / resolution, (double)(rows - 1));
+  int r = min((int)x, rows - 2);
+  double f = x - r;
+  double total = durations[r] + f * (durations[r + 1] - durations[r]);
+  if(t <= 0) {
+    return 0;
+  }
+  if(t >= total) {
+    return dv;
+  }
+  double position = t / total * SAMPLES;
+  int k = min((int)position, SAMPLES - 1);
+  double g = position - k;
+  double low = fraction(r, k) + g * (fraction(r, k + 1) - fraction(r, k));
+  double high = fraction(r + 1, k) + g * (fraction(r + 1, k + 1) - fraction(r + 1, k));
+  return dv * (low + f * (high - low));
+}
+
+void speed_profile::plan(double t0, double v0, double a0, double target, const s_curve_table &curve) {
+  start_time = t0;
+  start_speed = v0;
+  start_accel = a0;
+  settle_time = fabs(a0) / curve.max_jerk();
+  settled_speed = v0 + a0 * settle_time / 2;
+  target_speed = target;
+}
+
+double speed_profile::speed(double t, const s_curve_table &curve) const {
+  double dt = t - start_time;
+  double v;
+  if(dt < settle_time) {
+    v = start_speed + start_accel * dt - copysign(curve.max_jerk(), start_accel) * dt * dt / 2;
+  } else {
+    v = settled_speed + curve.at(target_speed - settled_speed, dt - settle_time);
+  }
+  return max(v, 0.0);
+}
+
+double speed_profile::accel(double t, const s_curve_table &curve) const {
+  return (speed(t + ACCEL_STEP, curve) - speed(t - ACCEL_STEP, curve)) / (2 * ACCEL_STEP);
+}
@@ -0,0 +1,58 @@
+#ifndef SPEED_PROFILE_H
+#define SPEED_PROFILE_H
+
+#include <vector>
+
+// Jerk-limited speed changes ("S-curves") from rest acceleration to rest
+// acceleration, sampled once for every size of change up to max_change in
+// steps of resolution. The speed of a change at some time is then two table
+// lookups and a few interpolations.
+class s_curve_table {
+public:
+  s_curve_table(double max_accel, double max_jerk, double max_change = 30, double resolution = 0.1);
+
+  double max_accel() const { return accel; }
+  double max_jerk() const { return jerk; }
+
+  // Seconds a speed change of dv takes
+  double duration(double dv) const;
+
+  // Speed gained t seconds into a change of dv; dv may be negative
+  double at(double dv, double t) const;
+
+  static const int SAMPLES = 64; // per change, evenly spread over its duration
+
+private:
+  // fraction of dv reached at sample k of row r, and the row's duration
+  double fraction(int row, int k) const { return fractions[row * (SAMPLES + 1) + k]; }
+
+  double accel;
+  double jerk;
+  double resolution;
+  int rows;
+  std::vector<double> durations;
+  std::vector<double> fractions;
+};
+
+// Speed of the ego car from start_time on: the acceleration it had then is
+// first brought to 0 at the jerk limit, then an S-curve of the table takes it
+// to the target speed, which it keeps.
+class speed_profile {
+public:
+  // Plans a change from speed v0 and acceleration a0 at time t0 to target
+  void plan(double t0, double v0, double a0, double target, const s_curve_table &curve);
+
+  double speed(double t, const s_curve_table &curve) const;
+  double accel(double t, const s_curve_table &curve) const;
+  double target() const { return target_speed; }
+
+private:
+  double start_time = 0;
+  double start_speed = 0;
+  double start_accel = 0;
+  double settle_time = 0; // s to bring start_accel to 0
+  double settled_speed = 0;
+  double target_speed = 0;
+};
+
+#endif // SPEED_PROFILE_H
@@ -0,0 +1,250 @@
+#ifndef STAGE_STATS_H
+#define STAGE_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "json.hpp"
+#include "alloc_stats.h"
+
+// Fixed-memory latency histogram in the spirit of HdrHistogram. Values (in
+// nanoseconds) below 2^SUB_BITS are counted exactly, above that every power of
+// two is split in HALF linear sub-buckets, which keeps the relative error of a
+// reported percentile below 1/HALF (~6%) with no allocation after construction.
+class latency_histogram {
+public:
+  static const int SUB_BITS = 5;
+  static const int HALF = 1 << (SUB_BITS - 1);
+  static const int MAX_BITS = 40; // ~18 minutes, anything longer is clamped
+  static const int BUCKETS = (MAX_BITS - SUB_BITS + 2) * HALF;
+
+  latency_histogram() { reset(); }
+
+  void reset() {
+    for(int i = 0; i < BUCKETS; i++) {
+      counts[i] = 0;
+    }
+    total = 0;
+    sum = 0;
+    min_value = UINT64_MAX;
+    max_value = 0;
+  }
+
+  void record(uint64_t value) {
+    counts[bucket_of(value)]++;
+    total++;
+    sum += value;
+    if(value < min_value) min_value = value;
+    if(value > max_value) max_value = value;
+  }
+
+  uint64_t count() const { return total; }
+  uint64_t min() const { return total ? min_value : 0; }
+  uint64_t max() const { return max_value; }
+  double mean() const { return total ? (double)sum / total : 0; }
+
+  // Upper bound of the bucket holding the given percentile (0 - 100)
+  uint64_t percentile(double p) const {
+    if(total == 0) {
+      return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+    if(rank < 1) rank = 1;
+    if(rank > total) rank = total;
+
+    uint64_t seen = 0;
+    for(int i = 0; i < BUCKETS; i++) {
+      seen += counts[i];
+      if(seen >= rank) {
+        uint64_t upper = lowest_of(i + 1) - 1;
+        return upper < max_value ? upper : max_value;
+      }
+    }
+    return max_value;
+  }
+
+  static int bucket_of(uint64_t value) {
+    if(value >= (1ULL << MAX_BITS)) {
+      value = (1ULL << MAX_BITS) - 1;
+    }
+    if(value < (1ULL << SUB_BITS)) {
+      return (int)value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int top = (int)(value >> (msb - SUB_BITS + 1));
+    return (msb - SUB_BITS + 2) * HALF + (top - HALF);
+  }
+
+  static uint64_t lowest_of(int bucket) {
+    if(bucket < (1 << SUB_BITS)) {
+      return bucket;
+    }
+    int octave = bucket / HALF;
+    int sub = bucket % HALF;
+    return (uint64_t)(HALF + sub) << (octave - 1);
+  }
+
+private:
+  uint64_t counts[BUCKETS];
+  uint64_t total;
+  uint64_t sum;
+  uint64_t min_value;
+  uint64_t max_value;
+};
+
+// Stages of one telemetry cycle in onMessage, in the order they run
+enum cycle_stage {
+  STAGE_DECODE,
+  STAGE_SENSOR_FUSION,
+  STAGE_LANE_DECISION,
+  STAGE_SPLINE_FIT,
+  STAGE_PATH_EMISSION,
+  STAGE_SERIALIZATION,
+  STAGE_SEND,
+  STAGE_CYCLE, // whole cycle, from receiving the frame to the end of send
+  STAGE_COUNT
+};
+
+inline const char *stage_name(int stage) {
+  static const char *names[STAGE_COUNT] = {
+    "decode", "sensor_fusion", "lane_decision", "spline_fit",
+    "path_emission", "serialization", "send", "cycle"
+  };
+  return names[stage];
+}
+
+// Histograms and counters for all stages. Only touched from the uWS event loop
+// thread, so plain counters are enough.
+struct stage_stats {
+  latency_histogram stages[STAGE_COUNT];
+  // heap allocations per stage, only counted in allocation accounting builds
+  uint64_t allocations[STAGE_COUNT] = {};
+  uint64_t allocated_bytes[STAGE_COUNT] = {};
+  uint64_t max_allocations[STAGE_COUNT] = {};
+  uint64_t telemetry_frames = 0;
+  uint64_t manual_frames = 0;
+  uint64_t lane_changes_left = 0;
+  uint64_t lane_changes_right = 0;
+  uint64_t path_collisions = 0; // paths sent that the collision checker flagged
+  uint64_t path_rejections = 0; // paths the validator replaced with a fallback
+  uint64_t malformed_frames = 0; // telemetry that failed to decode
+
+  void reset() {
+    for(int i = 0; i < STAGE_COUNT; i++) {
+      stages[i].reset();
+      allocations[i] = 0;
+      allocated_bytes[i] = 0;
+      max_allocations[i] = 0;
+    }
+    telemetry_frames = 0;
+    manual_frames = 0;
+    lane_changes_left = 0;
+    lane_changes_right = 0;
+    path_collisions = 0;
+    path_rejections = 0;
+    malformed_frames = 0;
+  }
+
+  // Percentiles are reported in microseconds
+  nlohmann::json to_json() const {
+    nlohmann::json out;
+    out["counters"]["telemetry_frames"] = telemetry_frames;
+    out["counters"]["manual_frames"] = manual_frames;
+    out["counters"]["lane_changes_left"] = lane_changes_left;
+    out["counters"]["lane_changes_right"] = lane_changes_right;
+    out["counters"]["path_collisions"] = path_collisions;
+    out["counters"]["path_rejections"] = path_rejections;
+    out["counters"]["malformed_frames"] = malformed_frames;
+    for(int i = 0; i < STAGE_COUNT; i++) {
+      const latency_histogram &h = stages[i];
+      nlohmann::json &st = out["stages_us"][stage_name(i)];
+      st["count"] = h.count();
+      st["mean"] = h.mean() / 1000.0;
+      st["min"] = h.min() / 1000.0;
+      st["p50"] = h.percentile(50) / 1000.0;
+      st["p90"] = h.percentile(90) / 1000.0;
+      st["p99"] = h.percentile(99) / 1000.0;
+      st["p99.9"] = h.percentile(99.9) / 1000.0;
+      st["max"] = h.max() / 1000.0;
+
+      if(alloc_stats_enabled()) {
+        nlohmann::json &al = out["allocations_per_cycle"][stage_name(i)];
+        al["mean"] = h.count() ? (double)allocations[i] / h.count() : 0;
+        al["max"] = max_allocations[i];
+        al["bytes_mean"] = h.count() ? (double)allocated_bytes[i] / h.count() : 0;
+      }
+    }
+    return out;
+  }
+};
+
+// Records the time spent between consecutive lap() calls into the stage
+// histograms. Costs one steady_clock read per stage, plus a thread-local read
+// in allocation accounting builds.
+class stage_timer {
+public:
+  typedef std::chrono::steady_clock clock;
+
+  explicit stage_timer(stage_stats &stats) : stats(stats) {
+    start = last = clock::now();
+    start_allocs = last_allocs = alloc_snapshot();
+    for(int i = 0; i < STAGE_COUNT; i++) {
+      elapsed[i] = 0;
+      allocations[i] = 0;
+    }
+  }
+
+  uint64_t lap(cycle_stage stage) {
+    clock::time_point now = clock::now();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+    stats.stages[stage].record(ns);
+    elapsed[stage] = ns;
+    last = now;
+    count_allocations(stage, last_allocs);
+    return ns;
+  }
+
+  // Time since construction, without recording it
+  uint64_t since_start() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+  }
+
+  // Records the whole cycle since construction
+  uint64_t finish() {
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start).count();
+    stats.stages[STAGE_CYCLE].record(ns);
+    elapsed[STAGE_CYCLE] = ns;
+    count_allocations(STAGE_CYCLE, start_allocs);
+    return ns;
+  }
+
+  // Last measured duration and allocation count of every stage in this cycle
+  uint64_t elapsed[STAGE_COUNT];
+  uint64_t allocations[STAGE_COUNT];
+
+private:
+  void count_allocations(cycle_stage stage, alloc_counter &since) {
+    if(!alloc_stats_enabled()) {
+      return;
+    }
+    alloc_counter now = alloc_snapshot();
+    uint64_t count = now.count - since.count;
+    allocations[stage] = count;
+    stats.allocations[stage] += count;
+    stats.allocated_bytes[stage] += now.bytes - since.bytes;
+    if(count > stats.max_allocations[stage]) {
+      stats.max_allocations[stage] = count;
+    }
+    if(stage != STAGE_CYCLE) {
+      since = now;
+    }
+  }
+
+  stage_stats &stats;
+  clock::time_point start;
+  clock::time_point last;
+  alloc_counter start_allocs;
+  alloc_counter last_allocs;
+};
+
+#endif // STAGE_STATS_H
@@ -0,0 +1,259 @@
+#ifndef SYNTHETIC_DRIVE_H
+#define SYNTHETIC_DRIVE_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include "planner.h"
+
+// Deterministic closed-loop stand-in for the simulator, used to record replay
+// corpora without the Unity simulator. The ego car follows the points it is
+// sent like the simulator's perfect controller, and the other cars keep their
+// speed along the lanes, one of them changing lanes after a few seconds. On
+// roads of more than three lanes, the lanes past the third repeat the traffic
+// of the first three, a little further along.
+// Replies may be made to land a few steps late, in which case the car drives
+// on along the old path until they do, like the simulator.
+class synthetic_drive {
+public:
+  explicit synthetic_drive(const highway_map &map, int lanes = 3) : map(map), ego_speed(0), time(0) {
+    // where the simulator spawns the ego car
+    ego_x = 909.48;
+    ego_y = 1128.67;
+    ego_yaw = 0;
+
+    // id, s, d, speed (m/s)
+    const double initial[][4] = {
+      {0, 190, 6, 8},  {1, 160, 2, 17}, {2, 230, 2, 19}, {3, 300, 2, 18},
+      {4, 100, 6, 20}, {5, 330, 6, 21}, {6, 420, 6, 16}, {7, 150, 10, 18},
+      {8, 210, 10, 16}, {9, 280, 10, 20}, {10, 390, 10, 22}, {11, 60, 10, 22}
+    };
+    for(const auto &c : initial) {
+      traffic_car car;
+      car.id = (int)c[0];
+      car.s = c[1];
+      car.d = c[2];
+      car.speed = c[3];
+      traffic.push_back(car);
+    }
+    const size_t scene = traffic.size();
+    for(int lane = 3; lane < lanes; lane++) {
+      for(size_t i = 0; i < scene; i++) {
+        traffic_car car = traffic[i];
+        if(car.d == LANE_WIDTH * (lane % 3) + LANE_WIDTH / 2) {
+          car.id = (int)traffic.size();
+          car.s += 25 * lane;
+          car.d += LANE_WIDTH * (lane - lane % 3);
+          traffic.push_back(car);
+        }
+      }
+    }
+  }
+
+  // The same scene moved along the road so that the ego car starts at start_s
+  synthetic_drive(const highway_map &map, double start_s, int lanes = 3) : synthetic_drive(map, lanes) {
+    vector<double> at = getXY(map.wrap_s(start_s), SPAWN_D, map.waypoints_s, map.waypoints_x, map.waypoints_y);
+    vector<double> ahead = getXY(map.wrap_s(start_s + 1), SPAWN_D, map.waypoints_s, map.waypoints_x,
+                                 map.waypoints_y);
+    ego_x = at[0];
+    ego_y = at[1];
+    ego_yaw = atan2(ahead[1] - at[1], ahead[0] - at[0]);
+    for(traffic_car &car : traffic) {
+      car.s = map.wrap_s(car.s + start_s - SPAWN_S);
+    }
+  }
+
+  // Telemetry the simulator would send now, as plain values
+  struct telemetry {
+    double x, y, s, d;
+    double yaw; // degrees
+    double speed; // MPH
+    double end_path_s, end_path_d;
+    vector<double> previous_x, previous_y;
+    vector<double> sensor_fusion; // [id, x, y, vx, vy, s, d] rows
+  };
+
+  void current_telemetry(telemetry &t) const {
+    vector<double> frenet = getFrenet(ego_x, ego_y, ego_yaw, map.waypoints_x, map.waypoints_y);
+    t.x = round4(ego_x);
+    t.y = round4(ego_y);
+    t.s = round4(frenet[0]);
+    t.d = round4(frenet[1]);
+    t.yaw = round4(rad2deg(ego_yaw));
+    t.speed = round4(ego_speed / 0.44704);
+
+    t.previous_x.clear();
+    t.previous_y.clear();
+    for(size_t i = 0; i < remaining_x.size(); i++) {
+      t.previous_x.push_back(round4(remaining_x[i]));
+      t.previous_y.push_back(round4(remaining_y[i]));
+    }
+
+    double end_s = 0, end_d = 0;
+    size_t n = remaining_x.size();
+    if(n >= 2) {
+      double yaw = atan2(remaining_y[n-1] - remaining_y[n-2], remaining_x[n-1] - remaining_x[n-2]);
+      vector<double> end = getFrenet(remaining_x[n-1], remaining_y[n-1], yaw, map.waypoints_x, map.waypoints_y);
+      end_s = end[0];
+      end_d = end[1];
+    }
+    t.end_path_s = round4(end_s);
+    t.end_path_d = round4(end_d);
+
+    t.sensor_fusion.clear();
+    for(const traffic_car &car : traffic) {
+      vector<double> xy = getXY(car.s, car.d, map.waypoints_s, map.waypoints_x, map.waypoints_y);
+      vector<double> ahead = getXY(car.s + 1, car.d, map.waypoints_s, map.waypoints_x, map.waypoints_y);
+      double heading = atan2(ahead[1] - xy[1], ahead[0] - xy[0]);
+      t.sensor_fusion.insert(t.sensor_fusion.end(),
+                             {(double)car.id, round4(xy[0]), round4(xy[1]),
+                              round4(car.speed * cos(heading)), round4(car.speed * sin(heading)),
+                              round4(car.s), round4(car.d)});
+    }
+  }
+
+  // The planner's view of t, arriving half of lag_steps after it was sampled
+  telemetry_frame frame(const telemetry &t, int lag_steps) const {
+    telemetry_frame f;
+    f.x = t.x;
+    f.y = t.y;
+    f.s = t.s;
+    f.d = t.d;
+    f.yaw = t.yaw;
+    f.speed = t.speed;
+    f.end_path_s = t.end_path_s;
+    f.end_path_d = t.end_path_d;
+    f.previous_x = t.previous_x.data();
+    f.previous_y = t.previous_y.data();
+    f.previous_size = t.previous_x.size();
+    f.sensor_fusion = t.sensor_fusion.data();
+    f.vehicles = t.sensor_fusion.size() / telemetry_frame::SENSOR_FUSION_FIELDS;
+    // simulation time, from 1 s on as 0 means unknown
+    f.received_ns = (int64_t)std::llround((time + 1 + lag_steps * 0.01) * 1e9);
+    // the simulation stands still while the planner runs
+    f.planning_ns = 0;
+    return f;
+  }
+
+  // Telemetry event as the simulator would send it now
+  std::string telemetry_message() const {
+    telemetry t;
+    current_telemetry(t);
+    json data;
+    data["x"] = t.x;
+    data["y"] = t.y;
+    data["s"] = t.s;
+    data["d"] = t.d;
+    data["yaw"] = t.yaw;
+    data["speed"] = t.speed;
+    data["previous_path_x"] = t.previous_x;
+    data["previous_path_y"] = t.previous_y;
+    data["end_path_s"] = t.end_path_s;
+    data["end_path_d"] = t.end_path_d;
+
+    json sensor_fusion = json::array();
+    const int fields = telemetry_frame::SENSOR_FUSION_FIELDS;
+    for(size_t i = 0; i < t.sensor_fusion.size(); i += fields) {
+      const double *row = &t.sensor_fusion[i];
+      // the simulator sends the ids as integers
+      sensor_fusion.push_back({(int)row[0], row[1], row[2], row[3], row[4], row[5], row[6]});
+    }
+    data["sensor_fusion"] = sensor_fusion;
+
+    return "42[\"telemetry\"," + data.dump() + "]";
+  }
+
+  // Takes the path sent back by the planner and lets the simulator run the
+  // given number of 20 ms steps, the first lag_steps of them still on the
+  // old path as the reply is on its way.
+  void advance(const vector<double> &next_x, const vector<double> &next_y, int steps, int lag_steps = 0) {
+    for(int step = 0; step < steps; step++) {
+      if(step == lag_steps) {
+        remaining_x = next_x;
+        remaining_y = next_y;
+      }
+      double dx = 0, dy = 0;
+      if(!remaining_x.empty()) {
+        dx = remaining_x[0] - ego_x;
+        dy = remaining_y[0] - ego_y;
+        ego_speed = sqrt(dx*dx + dy*dy) / 0.02;
+        if(ego_speed > 0.01) {
+          ego_yaw = atan2(dy, dx);
+        }
+        ego_x = remaining_x[0];
+        ego_y = remaining_y[0];
+        remaining_x.erase(remaining_x.begin());
+        remaining_y.erase(remaining_y.begin());
+      } else {
+        ego_speed = 0;
+      }
+      measure_acceleration(dx, dy);
+      move_traffic();
+    }
+    if(lag_steps >= steps) {
+      remaining_x = next_x;
+      remaining_y = next_y;
+    }
+  }
+
+  // Largest acceleration of the ego car, in m/s^2: from one step to the
+  // next, and as the simulator measures it, averaged over ACCEL_WINDOW steps
+  double max_step_acceleration() const { return max_step_accel; }
+  double max_acceleration() const { return max_accel; }
+
+  static const int ACCEL_WINDOW = 10; // steps, the simulator's 0.2 s
+
+private:
+  struct traffic_car {
+    int id;
+    double s;
+    double d;
+    double speed;
+  };
+
+  static double round4(double v) { return std::round(v * 1e4) / 1e4; }
+
+  // m, of the simulator's road
+  static constexpr double LANE_WIDTH = 4;
+
+  // Frenet coordinates of the spawn point
+  static constexpr double SPAWN_S = 124.8338;
+  static constexpr double SPAWN_D = 6.165;
+
+  // Takes the step the ego car just drove. Velocity changes, not speed
+  // changes, so that driving back to a point passed counts too; before the
+  // first step the car stands still.
+  void measure_acceleration(double dx, double dy) {
+    const int last = (steps_driven + ACCEL_WINDOW - 1) % ACCEL_WINDOW;
+    const int oldest = steps_driven % ACCEL_WINDOW;
+    double step_accel = hypot(dx - past_dx[last], dy - past_dy[last]) / (0.02 * 0.02);
+    double window_accel = hypot(dx - past_dx[oldest], dy - past_dy[oldest]) / (0.02 * 0.02 * ACCEL_WINDOW);
+    max_step_accel = std::max(max_step_accel, step_accel);
+    max_accel = std::max(max_accel, window_accel);
+    past_dx[oldest] = dx;
+    past_dy[oldest] = dy;
+    steps_driven++;
+  }
+
+  void move_traffic() {
+    time += 0.02;
+    for(traffic_car &car : traffic) {
+      car.s = fmod(car.s + car.speed * 0.02, map.max_s);
+      // car 10 moves from the right to the middle lane between 6 s and 9 s
+      if(car.id == 10 && time > 6 && time < 9) {
+        car.d = 10 - 4 * (time - 6) / 3;
+      }
+    }
+  }
+
+  const highway_map &map;
+  double ego_x, ego_y, ego_yaw, ego_speed;
+  double time;
+  double past_dx[ACCEL_WINDOW] = {}, past_dy[ACCEL_WINDOW] = {}; // of the last steps driven
+  int steps_driven = 0;
+  double max_step_accel = 0, max_accel = 0;
+  vector<double> remaining_x, remaining_y;
+  vector<traffic_car> traffic;
+};
+
+#endif // SYNTHETIC_DRIVE_H
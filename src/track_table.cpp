@@ -0,0 +1,131 @@
+#include <math.h>
+#include "track_table.h"
+
+namespace {
+
+uint32_t hash_id(int id) {
+  return (uint32_t)id * 2654435761u;
+}
+
+uint32_t power_of_two(int capacity) {
+  uint32_t size = 1;
+  while(size < (uint32_t)capacity) {
+    size <<= 1;
+  }
+  return size;
+}
+
+}
+
+track_table::track_table(int capacity) : filters(power_of_two(capacity)) {
+  uint32_t size = power_of_two(capacity);
+  vehicle_track empty = {};
+  empty.id = EMPTY;
+  slots.assign(size, empty);
+  mask = size - 1;
+}
+
+void track_table::begin_frame(double elapsed) {
+  frame++;
+  dt = elapsed;
+}
+
+int track_table::slot_of(int id) const {
+  uint32_t i = hash_id(id) & mask;
+  for(uint32_t probes = 0; probes <= mask; probes++, i = (i + 1) & mask) {
+    if(slots[i].id == id) {
+      return i;
+    }
+    if(slots[i].id == EMPTY) {
+      return -1;
+    }
+  }
+  return -1;
+}
+
+const vehicle_track *track_table::find(int id) const {
+  int i = id >= 0 ? slot_of(id) : -1;
+  return i >= 0 ? &slots[i] : nullptr;
+}
+
+const vehicle_track *track_table::update(int id, double s, double d, double speed) {
+  if(id < 0) {
+    return nullptr;
+  }
+  int i = slot_of(id);
+  if(i < 0) {
+    // new vehicle: take the first empty slot on its probe path
+    uint32_t j = hash_id(id) & mask;
+    for(uint32_t probes = 0; probes <= mask; probes++, j = (j + 1) & mask) {
+      if(slots[j].id == EMPTY) {
+        i = j;
+        break;
+      }
+    }
+    // keep one slot empty so probes for unknown ids end
+    if(i < 0 || live + 1 > (int)mask) {
+      return nullptr;
+    }
+    vehicle_track &track = slots[i];
+    track.id = id;
+    track.updates = 0;
+    track.s = s;
+    track.d = d;
+    track.speed = speed;
+    track.accel = 0;
+    track.d_rate = 0;
+    filters.start(i, s, speed, d);
+    live++;
+  } else {
+    filters.observe(i, s, speed, d);
+  }
+
+  vehicle_track &track = slots[i];
+  track.last_seen = frame;
+  track.updates++;
+  return &track;
+}
+
+void track_table::filter(double max_s) {
+  filters.step(dt, max_s);
+  for(size_t i = 0; i < slots.size(); i++) {
+    vehicle_track &track = slots[i];
+    if(track.id < 0) {
+      continue;
+    }
+    const frenet_filter &estimate = filters[i];
+    track.s = estimate.lon(0);
+    track.speed = estimate.lon(1);
+    track.accel = estimate.lon(2);
+    track.d = estimate.lat(0);
+    track.d_rate = estimate.lat(1);
+  }
+}
+
+// Backward shift deletion: every later track of the probe run whose home
+// slot is not between the hole and itself moves into the hole, which then
+// moves on to where that track was, until the run ends
+void track_table::remove(uint32_t i) {
+  filters.stop(i);
+  live--;
+  uint32_t hole = i;
+  for(uint32_t j = (i + 1) & mask; slots[j].id != EMPTY; j = (j + 1) & mask) {
+    uint32_t home = hash_id(slots[j].id) & mask;
+    if(((j - home) & mask) >= ((j - hole) & mask)) {
+      slots[hole] = slots[j];
+      filters.move(j, hole);
+      hole = j;
+    }
+  }
+  slots[hole].id = EMPTY;
+}
+
+void track_table::age() {
+  for(int n = 0; n < AGE_SWEEP; n++) {
+    vehicle_track &track = slots[cursor];
+    if(track.id >= 0 && frame - track.last_seen > MAX_AGE) {
+      remove(cursor);
+    }
+    cursor = (cursor + 1) & mask;
+  }
+}
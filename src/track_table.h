@@ -0,0 +1,71 @@
+#ifndef TRACK_TABLE_H
+#define TRACK_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+#include "kalman_filter.h"
+
+// What we know about one vehicle of sensor fusion across cycles
+struct vehicle_track {
+  int id; // sensor fusion id, or one of the markers of track_table
+  uint32_t last_seen; // frame of the last update
+  uint32_t updates; // frames the vehicle was seen in
+  // estimates of the last filter(), the observation until then
+  double s;
+  double d;
+  double speed; // m/s
+  double accel; // m/s^2
+  double d_rate; // lateral velocity in m/s, positive to the right
+};
+
+// Tracks keyed by sensor fusion id, kept for the whole connection. An open
+// addressing table with linear probing over a fixed power of two capacity, so
+// updates never allocate. Removing a track shifts the tracks after it in its
+// probe run back instead of leaving a tombstone, so lookups of unknown ids
+// stay short however many vehicles have come and gone. Vehicles that are not
+// seen any more are aged out a few slots per frame instead of in one sweep.
+// Every slot has a Kalman filter that smooths the observations; the filters
+// of all tracks run in one batch per frame.
+class track_table {
+public:
+  explicit track_table(int capacity = 256);
+
+  // Starts a frame that comes dt seconds of simulation after the previous
+  // one; dt <= 0 updates positions without rates.
+  void begin_frame(double dt);
+
+  // Takes the observation of a vehicle for this frame. Returns its track, or
+  // nullptr if the table is full.
+  const vehicle_track *update(int id, double s, double d, double speed);
+
+  // Runs the filters of all tracks over the frame and updates the estimates
+  // of the tracks. Call once per frame after the updates; s wraps at max_s.
+  void filter(double max_s);
+
+  const vehicle_track *find(int id) const;
+
+  // Drops tracks that were not updated for MAX_AGE frames, looking at
+  // AGE_SWEEP slots per call. Call once per frame.
+  void age();
+
+  int size() const { return live; }
+
+  static const uint32_t MAX_AGE = 25;
+  static const int AGE_SWEEP = 8;
+
+private:
+  static const int EMPTY = -1;
+
+  int slot_of(int id) const;
+  void remove(uint32_t i);
+
+  std::vector<vehicle_track> slots;
+  kalman_bank filters;
+  uint32_t mask;
+  uint32_t frame = 0;
+  double dt = 0;
+  int live = 0;
+  int cursor = 0;
+};
+
+#endif // TRACK_TABLE_H
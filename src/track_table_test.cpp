@@ -0,0 +1,163 @@
+// Churns vehicles through a track_table and checks every lookup against a
+// plain map of the ids that should be in it: ids of the same home slot come
+// and go, so removals shift whole probe runs back, and the ids that stay
+// must keep their own filters.
+//
+//   track_table_test
+
+#include <math.h>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "track_table.h"
+
+using namespace std;
+
+namespace {
+
+const int CAPACITY = 16;
+const double MAX_S = 6945.554; // m, of the stored map
+const double DT = 0.02; // s
+
+// Every vehicle drives at its own speed from its own s, so a track that
+// ended up with another one's filter shows
+double speed_of(int id) {
+  return 10 + id % 7;
+}
+
+double start_of(int id) {
+  return 100 + 37 * id;
+}
+
+// Ids whose home slot in a table of CAPACITY is home, as track_table hashes
+vector<int> ids_at(uint32_t home, int count) {
+  vector<int> ids;
+  for(int id = 0; (int)ids.size() < count; id++) {
+    if((((uint32_t)id * 2654435761u) & (CAPACITY - 1)) == home) {
+      ids.push_back(id);
+    }
+  }
+  return ids;
+}
+
+class churn {
+public:
+  // Runs a frame in which the vehicles of seen are observed
+  void step(const vector<int> &seen) {
+    frame++;
+    table.begin_frame(DT);
+    for(int id : seen) {
+      double s = fmod(start_of(id) + speed_of(id) * frame * DT, MAX_S);
+      if(!table.update(id, s, 6, speed_of(id))) {
+        fail("no track for id " + to_string(id));
+      }
+      last_seen[id] = frame;
+      last_s[id] = s;
+    }
+    table.filter(MAX_S);
+    table.age();
+  }
+
+  // Checks the tracks of every id ever seen against what they should be.
+  // An id not seen for more than MAX_AGE frames may still be there until
+  // the age sweep reaches its slot, but one seen since must be.
+  void check(uint32_t max_stale) {
+    int expected = 0;
+    for(auto &id_frame : last_seen) {
+      int id = id_frame.first;
+      uint32_t age = frame - id_frame.second;
+      const vehicle_track *track = table.find(id);
+      if(age <= track_table::MAX_AGE) {
+        expected++;
+        if(!track || track->id != id) {
+          fail("id " + to_string(id) + " seen " + to_string(age) + " frames ago is not found");
+        } else if(age == 0 && (fabs(track->s - last_s[id]) > 1 ||
+                               fabs(track->speed - speed_of(id)) > 0.5)) {
+          fail("id " + to_string(id) + " is at " + to_string(track->s) + " m and " +
+               to_string(track->speed) + " m/s, another vehicle's filter");
+        }
+      } else if(age > max_stale && track) {
+        fail("id " + to_string(id) + " not seen for " + to_string(age) + " frames is still found");
+      }
+    }
+    if(max_stale == track_table::MAX_AGE && table.size() != expected) {
+      fail(to_string(table.size()) + " tracks, " + to_string(expected) + " expected");
+    }
+  }
+
+  int failures = 0;
+
+private:
+  void fail(const string &message) {
+    cerr << "frame " << frame << ": " << message << endl;
+    failures++;
+  }
+
+  track_table table{CAPACITY};
+  map<int, uint32_t> last_seen;
+  map<int, double> last_s;
+  uint32_t frame = 0;
+};
+
+}
+
+int main() {
+  // a full sweep of the table takes CAPACITY / AGE_SWEEP frames
+  const uint32_t aged_out = track_table::MAX_AGE + CAPACITY / track_table::AGE_SWEEP + 1;
+  churn test;
+
+  // five ids on slot 3 and two on slot 4, whose probes run through the
+  // first five: one run of seven slots
+  vector<int> run = ids_at(3, 5);
+  for(int id : ids_at(4, 2)) {
+    run.push_back(id);
+  }
+  for(int i = 0; i < 5; i++) {
+    test.step(run);
+  }
+  test.check(track_table::MAX_AGE);
+
+  // every other one stops being seen; the rest move back over the holes
+  vector<int> kept;
+  for(size_t i = 0; i < run.size(); i += 2) {
+    kept.push_back(run[i]);
+  }
+  for(uint32_t i = 0; i < aged_out; i++) {
+    test.step(kept);
+    test.check(i < track_table::MAX_AGE ? track_table::MAX_AGE : aged_out);
+  }
+  test.check(track_table::MAX_AGE);
+
+  // then a long churn: vehicles come and go, ids of few home slots so the
+  // runs keep crossing each other and the end of the table. With the four
+  // above until they age out, that is at most 14 tracks; the table keeps
+  // one of its 16 slots empty.
+  vector<int> pool = ids_at(14, 4);
+  for(uint32_t home : {15u, 0u}) {
+    for(int id : ids_at(home, 3)) {
+      pool.push_back(id);
+    }
+  }
+  uint32_t state = 1;
+  vector<bool> present(pool.size(), false);
+  for(int frame = 0; frame < 2000; frame++) {
+    state = state * 1664525u + 1013904223u;
+    size_t flip = (state >> 16) % pool.size();
+    present[flip] = !present[flip];
+    vector<int> seen;
+    for(size_t i = 0; i < pool.size(); i++) {
+      if(present[i]) {
+        seen.push_back(pool[i]);
+      }
+    }
+    test.step(seen);
+    test.check(aged_out);
+  }
+
+  if(test.failures > 0) {
+    cout << "FAILED" << endl;
+    return 1;
+  }
+  cout << "PASSED" << endl;
+  return 0;
+}
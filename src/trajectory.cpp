@@ -0,0 +1,182 @@
+#include <math.h>
+#include "path_validator.h"
+#include "spline.h"
+#include "trajectory.h"
+
+namespace {
+
+const double PATH_MATCH_TOLERANCE = 1e-3; // m, our copy of the path and the simulator's may differ by this much
+const double STANDSTILL_STEP = 1e-3; // m per 20 ms step, below which the path end has no heading
+
+}
+
+bool matches_previous_path(const path_ring &path, const double *previous_x, const double *previous_y,
+                           int n) {
+  if(path.size() != n) {
+    return false;
+  }
+  if(n == 0) {
+    return true;
+  }
+  return fabs(path[0].x - previous_x[0]) < PATH_MATCH_TOLERANCE &&
+         fabs(path[0].y - previous_y[0]) < PATH_MATCH_TOLERANCE &&
+         fabs(path.back().x - previous_x[n - 1]) < PATH_MATCH_TOLERANCE &&
+         fabs(path.back().y - previous_y[n - 1]) < PATH_MATCH_TOLERANCE;
+}
+
+void append_path(path_ring &path, const double *x, const double *y, int n, double car_x,
+                 double car_y, double clock, const highway_map &map) {
+  path_buffer s(n);
+  path_buffer d(n);
+  frenet_path(map, x, y, n, s.data(), d.data());
+  double last_x = path.size() > 0 ? path.back().x : car_x;
+  double last_y = path.size() > 0 ? path.back().y : car_y;
+  for(int i = 0; i < n; i++) {
+    path_point point;
+    point.x = x[i];
+    point.y = y[i];
+    point.s = s[i];
+    point.d = d[i];
+    point.v = distance(last_x, last_y, x[i], y[i]) / 0.02;
+    point.t = clock + (path.size() + 1) * 0.02;
+    path.push(point);
+    last_x = x[i];
+    last_y = y[i];
+  }
+}
+
+// Where the spline of the new points starts, and its heading; the spline is
+// fitted in the coordinates of the car there
+struct spline_frame {
+  double x;
+  double y;
+  double yaw;
+};
+
+// Fits s from the end of the previous path, or from the car if there is
+// none, to the center of the lane at lane_center 30, 60 and 90 m ahead
+static spline_frame fit_path_spline(const highway_map &map, const path_ring &path, int prev_size,
+                                    double car_x, double car_y, double car_yaw, double car_s,
+                                    double lane_center, path_buffer &ptsx, path_buffer &ptsy,
+                                    tk::spline &s) {
+  ptsx.clear();
+  ptsy.clear();
+
+  // reference to where the car is at this instant
+  spline_frame frame;
+
+  // reference to where the car was an instant ago
+  double prev_car_x;
+  double prev_car_y;
+
+  // generate two points from where the car is, or from where it stands at
+  // the end of the previous path: two points at the same place give no
+  // heading, and the same x twice to the spline
+  if(prev_size < 2 || distance(path[prev_size - 2].x, path[prev_size - 2].y, path[prev_size - 1].x,
+                               path[prev_size - 1].y) < STANDSTILL_STEP) {
+    frame.x = prev_size < 2 ? car_x : path[prev_size - 1].x;
+    frame.y = prev_size < 2 ? car_y : path[prev_size - 1].y;
+    frame.yaw = deg2rad(car_yaw);
+
+    prev_car_x = frame.x - cos(frame.yaw);
+    prev_car_y = frame.y - sin(frame.yaw);
+  } else {
+    frame.x = path[prev_size - 1].x;
+    frame.y = path[prev_size - 1].y;
+
+    prev_car_x = path[prev_size - 2].x;
+    prev_car_y = path[prev_size - 2].y;
+
+    frame.yaw = atan2(frame.y - prev_car_y, frame.x - prev_car_x);
+  }
+  ptsx.push_back(prev_car_x);
+  ptsx.push_back(frame.x);
+
+  ptsy.push_back(prev_car_y);
+  ptsy.push_back(frame.y);
+
+  // generate three waypoints far apart from where we want to be; past the
+  // end of the loop they are on its start, not on the last segment extended
+  double next_wp0[2], next_wp1[2], next_wp2[2];
+  getXY(map.wrap_s(car_s + 30), lane_center, map.waypoints_s, map.waypoints_x, map.waypoints_y, next_wp0[0], next_wp0[1]);
+  getXY(map.wrap_s(car_s + 60), lane_center, map.waypoints_s, map.waypoints_x, map.waypoints_y, next_wp1[0], next_wp1[1]);
+  getXY(map.wrap_s(car_s + 90), lane_center, map.waypoints_s, map.waypoints_x, map.waypoints_y, next_wp2[0], next_wp2[1]);
+
+  ptsx.push_back(next_wp0[0]);
+  ptsx.push_back(next_wp1[0]);
+  ptsx.push_back(next_wp2[0]);
+
+  ptsy.push_back(next_wp0[1]);
+  ptsy.push_back(next_wp1[1]);
+  ptsy.push_back(next_wp2[1]);
+
+  // shift the coordinates to be the car coordinates
+  for(size_t i = 0; i < ptsx.size(); i++) {
+    // shift x and y to be with reference to the car location
+    double shift_x = ptsx[i] - frame.x;
+    double shift_y = ptsy[i] - frame.y;
+
+    ptsx[i] = (shift_x * cos(frame.yaw) + shift_y * sin(frame.yaw));
+    ptsy[i] = (shift_y * cos(frame.yaw) - shift_x * sin(frame.yaw));
+  }
+
+  // set spline x and y points
+  s.set_points(ptsx, ptsy);
+  return frame;
+}
+
+// Appends count points along s to next_x_vals/next_y_vals, the first one
+// 0.02 s after start_time
+static void emit_path(const tk::spline &s, const spline_frame &frame, const speed_profile &profile,
+                      const s_curve_table &curve, double start_time, int count,
+                      path_buffer &next_x_vals, path_buffer &next_y_vals) {
+  // each point 0.02 s at its own speed of the profile; x advances by the
+  // arc length over the slope of the spline halfway through the step, so
+  // the spacing holds on curves as well
+  double x_along = 0;
+  for(int i = 0; i < count; i++) {
+    double step = profile.speed(start_time + (i + 1) * 0.02, curve) * 0.02;
+    double slope = s.deriv(1, x_along);
+    double dx = step / sqrt(1 + slope * slope);
+    slope = s.deriv(1, x_along + dx / 2);
+    x_along += step / sqrt(1 + slope * slope);
+    double x_point = x_along;
+    double y_point = s(x_point);
+
+    double x_ref = x_point;
+    double y_ref = y_point;
+
+    x_point = x_ref * cos(frame.yaw) - y_ref * sin(frame.yaw);
+    y_point = x_ref * sin(frame.yaw) + y_ref * cos(frame.yaw);
+
+    x_point += frame.x;
+    y_point += frame.y;
+
+    next_x_vals.push_back(x_point);
+    next_y_vals.push_back(y_point);
+  }
+}
+
+void extend_path(const highway_map &map, const planner_config &config, planner_state &session,
+                 int prev_size, double car_x, double car_y, double car_yaw, double car_s, int lane,
+                 double start_time, int count, path_buffer &next_x_vals, path_buffer &next_y_vals,
+                 stage_timer *timer) {
+  // create a spline; it and its anchors live in the cycle's arena
+  tk::spline s;
+  path_buffer ptsx, ptsy;
+  spline_frame frame = fit_path_spline(map, session.path, prev_size, car_x, car_y, car_yaw, car_s,
+                                       config.lane_width * (lane + 0.5), ptsx, ptsy, s);
+  if(timer) {
+    timer->lap(STAGE_SPLINE_FIT);
+  }
+  emit_path(s, frame, session.profile, config.speed_curve, start_time, count, next_x_vals, next_y_vals);
+}
+
+path_check validate_path_ring(const path_ring &path, const path_buffer &next_x_vals,
+                              const path_buffer &next_y_vals, const planner_config &config) {
+  path_buffer path_d(path.size());
+  for(int i = 0; i < path.size(); i++) {
+    path_d[i] = path[i].d;
+  }
+  return validate_path(next_x_vals.data(), next_y_vals.data(), path_d.data(), path.size(), config);
+}
@@ -0,0 +1,32 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include "path_ring.h"
+#include "path_validator.h"
+#include "planner.h"
+
+// Whether the ring holds the points the simulator reports as not driven yet
+bool matches_previous_path(const path_ring &path, const double *previous_x, const double *previous_y,
+                           int n);
+
+// Appends n points given in x and y to the ring, the first of them
+// following the car at (car_x, car_y)
+void append_path(path_ring &path, const double *x, const double *y, int n, double car_x,
+                 double car_y, double clock, const highway_map &map);
+
+// Appends count points to next_x_vals/next_y_vals that continue the first
+// prev_size points of the session's path, or start at the car if there are
+// fewer than two: a spline to the center of lane 30, 60 and 90 m past car_s,
+// each point 0.02 s on at the speed the session's profile has then, the first
+// one at start_time + 0.02. STAGE_SPLINE_FIT is lapped on timer, if given,
+// once the spline is fitted.
+void extend_path(const highway_map &map, const planner_config &config, planner_state &session,
+                 int prev_size, double car_x, double car_y, double car_yaw, double car_s, int lane,
+                 double start_time, int count, path_buffer &next_x_vals, path_buffer &next_y_vals,
+                 stage_timer *timer);
+
+// Checks the whole path in the ring, which next_x_vals/next_y_vals copy
+path_check validate_path_ring(const path_ring &path, const path_buffer &next_x_vals,
+                              const path_buffer &next_y_vals, const planner_config &config);
+
+#endif // TRAJECTORY_H